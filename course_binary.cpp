@@ -8,23 +8,347 @@
 #include <cstdlib>   // для system("cls"), system("pause") под Windows
 #include <vector>    // для сортировки строк в памяти
 #include <algorithm> // std::sort для строк/векторов
+#include <deque>     // размеры сегментов (SegmentedList)
+#include <memory>    // std::unique_ptr для открытых сегментов
+#include <type_traits> // std::is_trivially_copyable для NodeCodec
+#include <string_view> // чтение строк без копирования (getView/nextView)
+#include <thread>      // пул потоков для параллельных обходов
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <optional>    // частичные результаты потоков в transform_reduce
+#include <map>         // прежние байты узлов для снимков (MVCC)
+#include <atomic>
+#include <charconv>    // from_chars/to_chars для импорта/экспорта
+#include <chrono>      // время импорта/экспорта в командной строке
+#include <random>      // значения генератора нагрузки
+#include <unordered_set> // уцелевшие узлы при восстановлении (rebuild)
+#include <cstddef>       // offsetof для записей каталога контейнера
+
+// Позиционный ввод-вывод (pread/pwrite) для IoEngine
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>  // flock — блокировка очереди между процессами (loadgen)
+#include <sys/wait.h>
+#define BL_HAVE_PREAD 1
+#else
+#define BL_HAVE_PREAD 0
+#endif
+
+// inotify + eventfd — пробуждение ждущих pop_front_wait записями других процессов
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <cerrno>
+#define BL_HAVE_INOTIFY 1
+#else
+#define BL_HAVE_INOTIFY 0
+#endif
+
+// Клонирование файла (snapshot_to): reflink и copy_file_range
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <linux/fs.h>  // FICLONE
+#define BL_HAVE_CLONE 1
+#else
+#define BL_HAVE_CLONE 0
+#endif
+
+// Корутины (C++20) — для AsyncBinaryList; в C++17 обёртки просто нет
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define BL_HAVE_COROUTINES 1
+#endif
+#endif
+#ifndef BL_HAVE_COROUTINES
+#define BL_HAVE_COROUTINES 0
+#endif
+
+// Аппаратный CRC32C: на x86-64 — SSE4.2 с проверкой процессора
+// при запуске, на ARMv8 — расширение CRC, если его включил компилятор
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define BL_CRC_X86 1
+#else
+#define BL_CRC_X86 0
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define BL_CRC_ARM 1
+#else
+#define BL_CRC_ARM 0
+#endif
 
 //-----------------------------------------------------
 // Структура заголовка файла (для двусвязного списка)
 //-----------------------------------------------------
+const int HEADER_MAGIC = 0x4C4E4942;  // "BINL" — признак текущего формата
+const int HEADER_VERSION = 2;         // 1 — старый 12-байтный заголовок
+
+// Флаги заголовка (поле flags)
+const int HF_CONTIGUOUS = 1;  // узлы лежат подряд в порядке списка (слот за слотом, см. align)
+const int HF_SORTED = 2;      // список упорядочен по возрастанию (operator<)
+const int HF_CHECKSUM = 4;    // за данными узла — CRC32C данных, в заголовке — его CRC
+const int HF_SLABS = 8;       // строки лежат в слотах классов размера (см. slabClass)
+
+// Классы размера слотов строк: ёмкость 8, 16, 24, 32, затем по два
+// класса на удвоение (48, 64, 96, 128, ...) до 1 МБ (safeguard длины
+// в NodeCodec). Слот класса c вмещает любую строку того же класса,
+// поэтому освобождённый слот годится следующей строке класса без
+// поиска по размеру; потери на округление — не больше трети.
+const int SLAB_CLASSES = 34;
+
+inline int slabCap(int c) {
+    if (c < 4) return 8 * (c + 1);
+    int k = (c - 4) / 2;
+    return ((c - 4) % 2 == 0 ? 48 : 64) << k;
+}
+
+inline int slabClass(int len) {
+    if (len <= 32) return len <= 8 ? 0 : (len + 7) / 8 - 1;
+    int c = 4;
+    while (c < SLAB_CLASSES - 1 && slabCap(c) < len) c++;
+    return c;
+}
+
 struct FileHeader {
     int head;  // позиция первого узла (-1, если список пуст)
     int tail;  // позиция последнего узла (-1, если список пуст)
     int size;  // число узлов в списке
+    int magic;    // HEADER_MAGIC (в файлах версии 1 этого поля нет)
+    int version;  // версия формата файла
+    int flags;    // набор HF_*
+    int gen;      // поколение: растёт при каждой записи заголовка
+    int align;    // выравнивание слотов узлов в байтах (0 — плотная упаковка)
+    unsigned crc; // CRC32C заголовка (при HF_CHECKSUM; считается с crc = 0)
+    int freeHead;  // свободные слоты узлов фиксированного размера: цепочка
+    int freeCount; // через поле next, prev = -2; freeHead действителен при freeCount > 0
+                   // (для строк — число слотов во всех slabHead)
+    int slabHead[SLAB_CLASSES];  // свободные слоты строк по классам (HF_SLABS),
+                                 // та же цепочка; 0 или -1 — класс пуст
+    int reserved[19];  // резерв под новые поля: заголовок всегда 256 байт
+};
+
+//-----------------------------------------------------
+// CRC32C (Castagnoli) — контрольные суммы узлов и заголовка.
+// На x86-64 (GCC/Clang) — инструкция crc32 из SSE4.2, если её
+// поддерживает процессор (проверяется один раз); на ARMv8 с
+// расширением CRC — его инструкции; иначе таблицы slicing-by-8.
+//-----------------------------------------------------
+struct Crc32cTables {
+    unsigned t[8][256];
+    Crc32cTables() {
+        for (unsigned i = 0; i < 256; i++) {
+            unsigned c = i;
+            for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1)));
+            t[0][i] = c;
+        }
+        for (unsigned i = 0; i < 256; i++) {
+            for (int s = 1; s < 8; s++) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        }
+    }
 };
 
+inline unsigned crc32cSoft(unsigned crc, const unsigned char* p, size_t n) {
+    static const Crc32cTables tb;
+    while (n >= 8) {
+        unsigned lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = tb.t[7][lo & 0xFF] ^ tb.t[6][(lo >> 8) & 0xFF] ^ tb.t[5][(lo >> 16) & 0xFF] ^ tb.t[4][lo >> 24]
+            ^ tb.t[3][hi & 0xFF] ^ tb.t[2][(hi >> 8) & 0xFF] ^ tb.t[1][(hi >> 16) & 0xFF] ^ tb.t[0][hi >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n--) crc = (crc >> 8) ^ tb.t[0][(crc ^ *p++) & 0xFF];
+    return crc;
+}
+
+#if BL_CRC_X86
+__attribute__((target("sse4.2")))
+inline unsigned crc32cHw(unsigned crc, const unsigned char* p, size_t n) {
+    unsigned long long c = crc;
+    for (; n >= 8; p += 8, n -= 8) {
+        unsigned long long v;
+        std::memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+    }
+    unsigned c32 = (unsigned)c;
+    while (n--) c32 = _mm_crc32_u8(c32, *p++);
+    return c32;
+}
+#elif BL_CRC_ARM
+inline unsigned crc32cHw(unsigned crc, const unsigned char* p, size_t n) {
+    for (; n >= 8; p += 8, n -= 8) {
+        unsigned long long v;
+        std::memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+    }
+    while (n--) crc = __crc32cb(crc, *p++);
+    return crc;
+}
+#endif
+
+inline unsigned crc32c(const void* data, size_t n, unsigned crc = 0) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+#if BL_CRC_X86
+    static const bool hw = __builtin_cpu_supports("sse4.2");
+    crc = hw ? crc32cHw(crc, p, n) : crc32cSoft(crc, p, n);
+#elif BL_CRC_ARM
+    crc = crc32cHw(crc, p, n);
+#else
+    crc = crc32cSoft(crc, p, n);
+#endif
+    return ~crc;
+}
+
+// CRC заголовка считается с нулевым полем crc
+inline unsigned headerCrc(const FileHeader& fh) {
+    FileHeader h = fh;
+    h.crc = 0;
+    return crc32c(&h, sizeof(h));
+}
+
 /*
- * Формат УЗЛА (в общем случае T — POD или простой тип):
- *   [ int prev ][ int next ][ T data ]
- * Для string и подобного делаем отдельную специализацию,
- * т.к. у string переменная длина.
+ * Формат УЗЛА:
+ *   [ int prev ][ int next ][ данные T ]( unsigned crc — при HF_CHECKSUM )
+ * Как именно T лежит в «данных», описывает NodeCodec<T>:
+ * для тривиально копируемых типов это sizeof(T) байт подряд,
+ * для string — [ int len ][ char data[len] ].
  */
 
+//-----------------------------------------------------
+// Кодек узла NodeCodec<T>
+//   fixedSize — размер данных известен при компиляции;
+//   size      — этот размер (0, если длина переменная);
+//   encodedSize/encode — запись значения в буфер;
+//   read      — чтение значения с текущей позиции потока;
+//   View      — тип «вида» на значение без копирования (см. getView).
+// Для нового типа записи достаточно специализировать NodeCodec,
+// сам BinaryList<T> переписывать не нужно.
+//-----------------------------------------------------
+template <class T>
+struct NodeCodec {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "Для нетривиальных типов нужна специализация NodeCodec<T>");
+
+    static constexpr bool fixedSize = true;
+    static constexpr int  size = (int)sizeof(T);
+
+    typedef const T& View;
+    static View view(const T& pinned) { return pinned; }
+
+    static const char* tag() { return "T"; }
+
+    static int encodedSize(const T&) { return size; }
+    static void encode(const T& v, char* out) {
+        std::memcpy(out, &v, size);
+    }
+    static void decode(const char* in, T& v) {
+        std::memcpy(&v, in, size);
+    }
+    static bool read(std::istream& is, T& v) {
+        char buf[size];
+        if (!is.read(buf, size)) return false;
+        decode(buf, v);
+        return true;
+    }
+};
+
+// std::string: [ int len ][ char data[len] ]
+template <>
+struct NodeCodec<std::string> {
+    static constexpr bool fixedSize = false;
+    static constexpr int  size = 0;
+
+    typedef std::string_view View;
+    static View view(const std::string& pinned) { return pinned; }
+
+    static const char* tag() { return "string"; }
+
+    static int encodedSize(const std::string& s) {
+        return (int)sizeof(int) + (int)s.size();
+    }
+    static void encode(const std::string& s, char* out) {
+        int len = (int)s.size();
+        std::memcpy(out, &len, sizeof(int));
+        std::memcpy(out + sizeof(int), s.data(), len);
+    }
+    static void decode(const char* in, std::string& s) {
+        int len;
+        std::memcpy(&len, in, sizeof(int));
+        s.assign(in + sizeof(int), len);
+    }
+    static bool read(std::istream& is, std::string& s) {
+        int len;
+        if (!is.read(reinterpret_cast<char*>(&len), sizeof(int))) return false;
+        if (len < 0 || len > 1000000) {
+            // простой safeguard
+            s.clear();
+            return false;
+        }
+        s.resize(len);
+        if (len > 0) is.read(&s[0], len);
+        return (bool)is;
+    }
+};
+
+//-----------------------------------------------------
+// Арена строк StringArena: байты всех строк в одном буфере,
+// строка i — это [offs[i], offs[i + 1]). Массовые чтения строк
+// (сортировка, перезапись файла) идут через арену: вместо
+// отдельной кучи на каждую строку — два растущих вектора.
+//-----------------------------------------------------
+class StringArena {
+public:
+    StringArena() : offs(1, 0) {}
+
+    void clear() {
+        bytes.clear();
+        offs.assign(1, 0);
+    }
+    void reserve(size_t count, size_t totalBytes) {
+        offs.reserve(count + 1);
+        bytes.reserve(totalBytes);
+    }
+    // Место под строку длины len (указатель действителен до следующего add)
+    char* add(int len) {
+        size_t at = bytes.size();
+        bytes.resize(at + len);
+        offs.push_back((int)bytes.size());
+        return bytes.data() + at;
+    }
+    void push_back(std::string_view v) {
+        char* dst = add((int)v.size());
+        if (!v.empty()) std::memcpy(dst, v.data(), v.size());
+    }
+    size_t size() const { return offs.size() - 1; }
+    size_t byteSize() const { return bytes.size(); }
+    std::string_view operator[](size_t i) const {
+        return std::string_view(bytes.data() + offs[i], offs[i + 1] - offs[i]);
+    }
+    // Первые 8 байт строки старшими разрядами вперёд (короче — нули):
+    // порядок чисел совпадает с порядком строк, если префиксы различны
+    unsigned long long prefix(size_t i) const {
+        unsigned long long k = 0;
+        int n = std::min(offs[i + 1] - offs[i], 8);
+        for (int j = 0; j < 8; j++) {
+            k <<= 8;
+            if (j < n) k |= (unsigned char)bytes[offs[i] + j];
+        }
+        return k;
+    }
+
+private:
+    std::vector<char> bytes;
+    std::vector<int>  offs;
+};
+
  //-----------------------------------------------------
  // Пользовательский тип Person (POD для простоты)
  //-----------------------------------------------------
@@ -63,862 +387,5843 @@ struct Person {
 };
 
 //-----------------------------------------------------
-//      1) Общий шаблон BinaryList<T> (для POD)
+// Ключ элемента для индексов KeyOf<T>
+//   Key   — тип ключа в find(key)/contains(key);
+//   key   — ключ значения, hash/equal — хеш и сравнение ключей.
+// По умолчанию ключ — само значение (сравнение побайтно).
 //-----------------------------------------------------
+inline unsigned hashBytes(const char* p, size_t n) {
+    unsigned h = 2166136261u;  // FNV-1a
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
 template <class T>
-class BinaryList : public std::fstream {
-private:
-    FileHeader fh;         // Заголовок списка (в памяти)
-    std::string fname;     // Имя файла
-    int iterPos;           // Позиция для итератора (или -1)
+struct KeyOf {
+    typedef T Key;
+    static const Key& key(const T& v) { return v; }
+    static unsigned hash(const Key& k) {
+        return hashBytes(reinterpret_cast<const char*>(&k), sizeof(Key));
+    }
+    static bool equal(const Key& a, const Key& b) {
+        return std::memcmp(&a, &b, sizeof(Key)) == 0;
+    }
+};
+
+template <>
+struct KeyOf<std::string> {
+    typedef std::string_view Key;
+    static Key key(const std::string& v) { return v; }
+    static unsigned hash(Key k) { return hashBytes(k.data(), k.size()); }
+    static bool equal(Key a, Key b) { return a == b; }
+};
+
+// Person ищем по имени
+template <>
+struct KeyOf<Person> {
+    typedef std::string_view Key;
+    static Key key(const Person& p) { return Key(p.name, strnlen(p.name, sizeof(p.name))); }
+    static unsigned hash(Key k) { return hashBytes(k.data(), k.size()); }
+    static bool equal(Key a, Key b) { return a == b; }
+};
+
+//-----------------------------------------------------
+// Форматы импорта/экспорта
+//   DF_TEXT — запись на строку (строки могут содержать пробелы;
+//             для Person — «имя возраст», возраст последним словом);
+//   DF_CSV  — поля через запятую, поле в кавычках может содержать
+//             запятые, кавычки ("") и переводы строк;
+//   DF_RAW  — подряд закодированные данные узлов (как NodeCodec<T>).
+//-----------------------------------------------------
+enum DataFormat { DF_TEXT, DF_CSV, DF_RAW };
 
+// Чтение файла большими блоками: записи выдаются видами на буфер
+// (вид действителен до следующего вызова). Запись длиннее блока
+// увеличивает буфер.
+class BlockReader {
 public:
-    // Конструктор/деструктор
-    BinaryList(const std::string& filename);
-    ~BinaryList();
+    explicit BlockReader(const std::string& path)
+        : in(path.c_str(), std::ios::binary), buf(1 << 20), pos(0), end(0), eof(false) {}
 
-    // Основные операции
-    void push_back(const T& value);
-    void insert(int index, const T& value);
-    void erase(int index);
-    T    get(int index);
-    void update(int index, const T& value);
-    void pop_back();
-    void pop_front(); 
-    void clear();
-    void print();
-    int  getSize() const;
-    void sort();  // Пузырьковая сортировка в файле (для фиксированных по размеру T)
+    bool is_open() const { return in.is_open(); }
 
-    // Итератор
-    void initIterator();
-    bool hasNext();
-    T    next();
+    // Следующая запись до '\n' ('\r' в конце отбрасывается); в csv
+    // перевод строки внутри кавычек записи не заканчивает
+    bool nextRecord(bool csv, std::string_view& rec) {
+        size_t scan = pos;
+        bool quoted = false;
+        while (true) {
+            for (; scan < end; scan++) {
+                char c = buf[scan];
+                if (c == '"' && csv) {
+                    quoted = !quoted;
+                }
+                else if (c == '\n' && !quoted) {
+                    rec = trimCR(pos, scan);
+                    pos = scan + 1;
+                    return true;
+                }
+            }
+            size_t done = scan - pos;
+            if (!refill()) break;
+            scan = pos + done;
+        }
+        if (pos == end) return false;
+        rec = trimCR(pos, end);  // последняя запись без '\n'
+        pos = end;
+        return true;
+    }
+
+    // Следующие n байт подряд
+    bool take(size_t n, const char*& p) {
+        while (end - pos < n) {
+            if (!refill()) return false;
+        }
+        p = buf.data() + pos;
+        pos += n;
+        return true;
+    }
 
 private:
-    // Вспомогательные функции чтения/записи заголовка
-    void readHeader();
-    void writeHeader();
+    std::string_view trimCR(size_t from, size_t to) const {
+        if (to > from && buf[to - 1] == '\r') to--;
+        return std::string_view(buf.data() + from, to - from);
+    }
+    // Сдвинуть непрочитанное в начало и дочитать блок
+    bool refill() {
+        if (eof) return false;
+        if (pos > 0) {
+            std::memmove(buf.data(), buf.data() + pos, end - pos);
+            end -= pos;
+            pos = 0;
+        }
+        if (end == buf.size()) {
+            buf.resize(buf.size() * 2);
+        }
+        in.read(buf.data() + end, (std::streamsize)(buf.size() - end));
+        size_t got = (size_t)in.gcount();
+        end += got;
+        if (got == 0) eof = true;
+        return got > 0;
+    }
+
+    std::ifstream in;
+    std::vector<char> buf;
+    size_t pos, end;
+    bool eof;
 };
 
-//-----------------------------------------------------
-// Реализация общего шаблона BinaryList<T> (POD версий)
-//-----------------------------------------------------
-template <class T>
-BinaryList<T>::BinaryList(const std::string& filename)
-    : std::fstream(), fname(filename), iterPos(-1)
-{
-    // Открываем бинарный файл (без trunc), чтобы сохранялся между запусками
-    open(fname.c_str(), std::ios::in | std::ios::out | std::ios::binary);
-    if (!is_open()) {
-        // Если файла нет, создаём
-        std::ofstream ff(fname.c_str(), std::ios::binary);
-        ff.close();
-        // И снова открываем на чтение+запись
-        open(fname.c_str(), std::ios::in | std::ios::out | std::ios::binary);
-    }
+// Окно файла для обходов по ссылкам: узлы, лежащие подряд, берутся
+// из одного большого блока; при переходе далеко от предыдущего узла
+// дочитывается только небольшой блок (у разбросанных узлов большой
+// блок пропал бы зря)
+class FileWindow {
+public:
+    static constexpr int BIG = 1 << 20;
+    static constexpr int SMALL = 4096;
 
-    if (is_open()) {
-        // Проверяем размер файла
-        seekg(0, std::ios::end);
-        std::streamoff sz = tellg();
-        if (sz < (std::streamoff)sizeof(FileHeader)) {
-            // Инициализируем заголовок пустого списка
-            fh.head = -1;
-            fh.tail = -1;
-            fh.size = 0;
-            writeHeader();
+    FileWindow(std::istream& s, int end) : in(s), fileEnd(end), winPos(0) {}
+
+    // need байт с позиции pos или nullptr (за пределами файла, ошибка
+    // чтения); seq — узел рядом с предыдущим, читать большим блоком
+    const char* at(int pos, int need, bool seq) {
+        if (pos >= winPos && pos + need <= winPos + (int)win.size()) {
+            return win.data() + (pos - winPos);
         }
-        else {
-            readHeader();
+        if (pos < 0 || need < 0 || need > fileEnd - pos) return nullptr;
+        int len = std::min(std::max(need, seq ? BIG : SMALL), fileEnd - pos);
+        win.resize(len);
+        in.seekg(pos, std::ios::beg);
+        in.read(win.data(), len);
+        winPos = pos;
+        if (!in) {
+            in.clear();
+            win.clear();
+            return nullptr;
+        }
+        return win.data();
+    }
+
+private:
+    std::istream& in;
+    int fileEnd;
+    std::vector<char> win;
+    int winPos;
+};
+
+// Одно поле CSV начиная с p; p сдвигается за поле и запятую
+inline bool csvField(const char*& p, const char* e, std::string& out) {
+    out.clear();
+    if (p < e && *p == '"') {
+        for (p++; p < e; p++) {
+            if (*p == '"') {
+                if (p + 1 < e && p[1] == '"') {
+                    out += '"';
+                    p++;
+                    continue;
+                }
+                p++;
+                break;
+            }
+            out += *p;
         }
     }
     else {
-        // На случай, если открыть не удалось вообще
-        fh.head = -1;
-        fh.tail = -1;
-        fh.size = 0;
+        const char* s = p;
+        while (p < e && *p != ',') p++;
+        out.assign(s, p - s);
+    }
+    if (p < e) {
+        if (*p != ',') return false;
+        p++;
     }
+    return true;
 }
 
-template <class T>
-BinaryList<T>::~BinaryList() {
-    if (is_open()) {
-        close();
+inline void csvQuote(std::string_view v, std::string& out) {
+    if (v.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out.append(v.data(), v.size());
+        return;
+    }
+    out += '"';
+    for (char c : v) {
+        if (c == '"') out += '"';
+        out += c;
     }
+    out += '"';
 }
 
-template <class T>
-void BinaryList<T>::readHeader() {
-    seekg(0, std::ios::beg);
-    read(reinterpret_cast<char*>(&fh), sizeof(FileHeader));
+inline std::string_view trimSpaces(std::string_view v) {
+    while (!v.empty() && (v.front() == ' ' || v.front() == '\t')) v.remove_prefix(1);
+    while (!v.empty() && (v.back() == ' ' || v.back() == '\t')) v.remove_suffix(1);
+    return v;
 }
 
-template <class T>
-void BinaryList<T>::writeHeader() {
-    seekp(0, std::ios::beg);
-    write(reinterpret_cast<const char*>(&fh), sizeof(FileHeader));
+inline bool parseInt(std::string_view v, int& out) {
+    v = trimSpaces(v);
+    if (v.empty()) return false;
+    auto r = std::from_chars(v.data(), v.data() + v.size(), out);
+    return r.ec == std::errc() && r.ptr == v.data() + v.size();
 }
 
-// Добавить элемент в конец (push_back)
-template <class T>
-void BinaryList<T>::push_back(const T& value) {
-    if (!is_open()) return; // Если файл не открыт, выходим.
-
-    // Определяем, куда писать новый узел
-    seekp(0, std::ios::end);
-    long newPos = tellp();  // позиция в байтах (long)
-
-    int prev = fh.tail; // Предыдущий элемент — текущий tail.
-    int next = -1; // Следующего элемента нет.
+inline void formatInt(int v, std::string& out) {
+    char b[16];
+    auto r = std::to_chars(b, b + sizeof(b), v);
+    out.append(b, r.ptr - b);
+}
 
-    // Записываем сам узел: [prev][next][T data]
-    seekp(newPos, std::ios::beg);
-    write(reinterpret_cast<char*>(&prev), sizeof(int));
-    write(reinterpret_cast<char*>(&next), sizeof(int));
-    write(reinterpret_cast<const char*>(&value), sizeof(T));
+//-----------------------------------------------------
+// Текстовое представление записи TextCodec<T> (для DF_TEXT/DF_CSV)
+//   parse  — разбор одной записи (tmp — рабочий буфер вызывающего);
+//   format — дописать запись в out без перевода строки;
+//   blankIsValue — пустая строка файла тоже значение (иначе пропуск).
+// Для нового типа записи достаточно специализировать TextCodec.
+//-----------------------------------------------------
+template <class T>
+struct TextCodec;
 
-    if (fh.size == 0) {
-        // Если список был пуст
-        fh.head = (int)newPos;
-        fh.tail = (int)newPos;
-        fh.size = 1;
-        writeHeader();
+template <>
+struct TextCodec<int> {
+    static constexpr bool blankIsValue = false;
+    static bool parse(std::string_view rec, bool, int& v, std::string&) {
+        return parseInt(rec, v);
     }
-    else {
-        // Обновляем next у бывшего tail
-        if (fh.tail != -1) {
-            seekp(fh.tail + sizeof(int), std::ios::beg); // tail + 4 => поле next
-            int newPosInt = (int)newPos;
-            write(reinterpret_cast<char*>(&newPosInt), sizeof(int));
-        }
-        fh.tail = (int)newPos;
-        fh.size++;
-        writeHeader();
+    static void format(const int& v, bool, std::string& out) {
+        formatInt(v, out);
     }
-}
+};
 
-// Вставка по индексу (insert)
-template <class T>
-void BinaryList<T>::insert(int index, const T& value) {
-    if (!is_open()) return;
-    if (index < 0 || index > fh.size) {
-        std::cout << "[T] Неверный индекс insert: " << index << "\n";
-        return;
+template <>
+struct TextCodec<std::string> {
+    static constexpr bool blankIsValue = true;
+    static bool parse(std::string_view rec, bool csv, std::string& v, std::string&) {
+        if (!csv) {
+            v.assign(rec.data(), rec.size());
+            return true;
+        }
+        const char* p = rec.data();
+        const char* e = p + rec.size();
+        return csvField(p, e, v) && p == e;
     }
-    // Если вставка в конец, то это просто push_back
-    if (index == fh.size) {
-        push_back(value);
-        return;
+    static void format(const std::string& v, bool csv, std::string& out) {
+        if (csv) csvQuote(v, out);
+        else out += v;
     }
-    // Если вставка в начало
-    if (index == 0) {
-        // Создаём новый узел в конце файла
-        seekp(0, std::ios::end);
-        long newPos = tellp();
-        int prev = -1;
-        int next = fh.head;
-        seekp(newPos, std::ios::beg);
-        write(reinterpret_cast<char*>(&prev), sizeof(int));
-        write(reinterpret_cast<char*>(&next), sizeof(int));
-        write(reinterpret_cast<const char*>(&value), sizeof(T));
+};
 
-        // Старому head проставляем prev = newPos
-        if (fh.head != -1) {
-            seekp(fh.head, std::ios::beg);
-            write(reinterpret_cast<char*>(&newPos), sizeof(int));
+template <>
+struct TextCodec<Person> {
+    static constexpr bool blankIsValue = false;
+    static bool parse(std::string_view rec, bool csv, Person& v, std::string& tmp) {
+        std::string_view name;
+        int age;
+        if (csv) {
+            const char* p = rec.data();
+            const char* e = p + rec.size();
+            if (!csvField(p, e, tmp)) return false;
+            std::string_view rest(p, e - p);  // возраст — число, кавычки не нужны
+            if (rest.size() >= 2 && rest.front() == '"' && rest.back() == '"') {
+                rest = rest.substr(1, rest.size() - 2);
+            }
+            if (!parseInt(rest, age)) return false;
+            name = tmp;
         }
-        fh.head = (int)newPos; // Новый head — это новый узел.
-        if (fh.size == 0) {
-            fh.tail = (int)newPos; // Если список был пуст, tail тоже новый узел.
+        else {
+            rec = trimSpaces(rec);
+            size_t sp = rec.find_last_of(" \t");
+            if (sp == std::string_view::npos || !parseInt(rec.substr(sp + 1), age)) return false;
+            name = trimSpaces(rec.substr(0, sp));
         }
-        fh.size++;
-        writeHeader(); // Обновляем заголовок.
-        return;
+        if (age < 0) return false;
+        std::memset(v.name, 0, sizeof(v.name));
+        std::memcpy(v.name, name.data(), std::min(name.size(), sizeof(v.name) - 1));
+        v.age = age;
+        return true;
     }
-
-    // Иначе вставка «в середину»
-    // Находим позицию узла, который сейчас на месте index
-    int currentPos = fh.head;
-    for (int i = 0; i < index; i++) {
-        seekg(currentPos + sizeof(int), std::ios::beg); // currentPos+4 => поле next
-        read(reinterpret_cast<char*>(&currentPos), sizeof(int));
+    static void format(const Person& v, bool csv, std::string& out) {
+        std::string_view name(v.name, strnlen(v.name, sizeof(v.name)));
+        if (csv) {
+            csvQuote(name, out);
+            out += ',';
+        }
+        else {
+            out.append(name.data(), name.size());
+            out += ' ';
+        }
+        formatInt(v.age, out);
     }
-    // currentPos — это позиция узла, который будет стоять после вставляемого
+};
 
-    // Считываем его prev (старый предыдущий)
-    int oldPrev;
-    seekg(currentPos, std::ios::beg);
-    read(reinterpret_cast<char*>(&oldPrev), sizeof(int)); // поле prev
+//-----------------------------------------------------
+// Файл хеш-индекса HashIndexFile (спутник списка: fname.hidx)
+//   [ HashIndexHeader ][ HashSlot x capacity ]
+// Открытая адресация с линейным пробированием. В слоте хранится
+// полный хеш ключа, поэтому рост таблицы не требует чтения списка.
+// Пока индекс открыт, в gen записано -1: после аварийного
+// завершения индекс считается устаревшим и перестраивается.
+//-----------------------------------------------------
+const int HIDX_MAGIC = 0x58444948;  // "HIDX"
+const int SLOT_EMPTY = -1;
+const int SLOT_DELETED = -2;
 
-    // Создаём новый узел (записываем в конец файла)
-    seekp(0, std::ios::end);
-    long newPos = tellp();
-    int newPrev = oldPrev;
-    int newNext = currentPos;
-    write(reinterpret_cast<char*>(&newPrev), sizeof(int));
-    write(reinterpret_cast<char*>(&newNext), sizeof(int));
-    write(reinterpret_cast<const char*>(&value), sizeof(T));
+struct HashIndexHeader {
+    int magic;
+    int capacity;  // число слотов (степень двойки)
+    int used;      // занятые слоты, включая удалённые
+    int live;      // живые записи
+    int gen;       // поколение списка (FileHeader::gen), -1 — индекс открыт
+};
 
-    // Теперь у узла currentPos поле prev = newPos
-    seekp(currentPos, std::ios::beg);
-    write(reinterpret_cast<char*>(&newPos), sizeof(int));
+struct HashSlot {
+    unsigned hash;
+    int pos;       // позиция узла, SLOT_EMPTY или SLOT_DELETED
+};
 
-    // У старого prev (если он не -1) поле next = newPos
-    if (oldPrev != -1) {
-        seekp(oldPrev + sizeof(int), std::ios::beg); // oldPrev + 4 => next
-        int np = (int)newPos;
-        write(reinterpret_cast<char*>(&np), sizeof(int));
-    }
+class HashIndexFile : public std::fstream {
+public:
+    HashIndexFile();
 
-    fh.size++;
-    writeHeader();
-}
+    // Открыть существующий индекс; false — файла нет или он битый
+    bool attach(const std::string& filename);
+    void detach(int gen);                // записать поколение и закрыть
+    int  storedGen() const;
 
-// Удаление по индексу (erase)
-template <class T>
-void BinaryList<T>::erase(int index) {
-    if (!is_open()) return;
-    if (index < 0 || index >= fh.size) {
-        std::cout << "[T] Неверный индекс erase: " << index << "\n";
-        return;
-    }
-    if (fh.size == 0) {
-        std::cout << "[T] Список пуст\n";
-        return;
-    }
+    void rebuild(const std::vector<HashSlot>& entries);
+    void add(unsigned hash, int pos);
+    void remove(unsigned hash, int pos);
+    // check(pos) проверяет кандидата; возвращает true, если подошёл
+    template <class Check> bool lookup(unsigned hash, Check check);
 
-    // Ищем узел
-    int currentPos = fh.head;
-    for (int i = 0; i < index; i++) {
-        seekg(currentPos + sizeof(int), std::ios::beg); // currentPos+4 => next
-        read(reinterpret_cast<char*>(&currentPos), sizeof(int));
-    }
-    // Считаем prev, next из него
-    int p, n;
-    seekg(currentPos, std::ios::beg);
-    read(reinterpret_cast<char*>(&p), sizeof(int));       // prev
-    read(reinterpret_cast<char*>(&n), sizeof(int));       // next
+private:
+    HashIndexHeader hh;
+    int loadedGen;  // gen на момент открытия
 
-    // Если удаляемый узел — это head
-    if (currentPos == fh.head) {
-        fh.head = n;
-    }
-    // Если удаляемый узел — это tail
-    if (currentPos == fh.tail) {
-        fh.tail = p;
-    }
-    // p->next = n
-    if (p != -1) {
-        seekp(p + sizeof(int), std::ios::beg);
-        write(reinterpret_cast<char*>(&n), sizeof(int));
-    }
-    // n->prev = p
-    if (n != -1) {
-        seekp(n, std::ios::beg);
-        write(reinterpret_cast<char*>(&p), sizeof(int));
-    }
+    void writeIndexHeader();
+    HashSlot readSlot(int i);
+    void writeSlot(int i, const HashSlot& s);
+    void grow();
+};
 
-    fh.size--;
-    writeHeader();
+HashIndexFile::HashIndexFile() : std::fstream(), loadedGen(-1) {
+    std::memset(&hh, 0, sizeof(hh));
 }
 
-// Получить элемент по индексу (get)
-template <class T>
-T BinaryList<T>::get(int index) {
-    T result{};
-    if (!is_open()) return result;
-    if (index < 0 || index >= fh.size) {
-        std::cout << "[T] Неверный индекс get: " << index << "\n";
-        return result;
+bool HashIndexFile::attach(const std::string& filename) {
+    if (is_open()) close();
+    open(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    if (!is_open()) {
+        std::ofstream ff(filename.c_str(), std::ios::binary);
+        ff.close();
+        open(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+        hh.magic = 0;
     }
-    // Идём по next'ам
-    int cur = fh.head;
-    for (int i = 0; i < index; i++) {
-        seekg(cur + sizeof(int), std::ios::beg);
-        read(reinterpret_cast<char*>(&cur), sizeof(int));
+    else {
+        seekg(0, std::ios::beg);
+        read(reinterpret_cast<char*>(&hh), sizeof(hh));
+        if (!good()) {
+            std::fstream::clear();
+            hh.magic = 0;
+        }
     }
-    // Читаем данные
-    seekg(cur + 2 * sizeof(int), std::ios::beg);
-    read(reinterpret_cast<char*>(&result), sizeof(T));
-    return result;
+    bool ok = hh.magic == HIDX_MAGIC && hh.capacity > 0
+        && (hh.capacity & (hh.capacity - 1)) == 0;
+    loadedGen = ok ? hh.gen : -1;
+    if (!ok) {
+        hh.magic = HIDX_MAGIC;
+        hh.capacity = 0;
+    }
+    hh.gen = -1;  // индекс открыт
+    writeIndexHeader();
+    flush();
+    return ok;
 }
 
-// Обновить элемент по индексу (update)
-template <class T>
-void BinaryList<T>::update(int index, const T& value) {
+void HashIndexFile::detach(int gen) {
     if (!is_open()) return;
-    if (index < 0 || index >= fh.size) {
-        std::cout << "[T] Неверный индекс update: " << index << "\n";
-        return;
-    }
-    // Идём до нужного узла
-    int cur = fh.head;
-    for (int i = 0; i < index; i++) {
-        seekg(cur + sizeof(int), std::ios::beg);
-        read(reinterpret_cast<char*>(&cur), sizeof(int));
-    }
-    seekp(cur + 2 * sizeof(int), std::ios::beg);
-    write(reinterpret_cast<const char*>(&value), sizeof(T));
+    hh.gen = gen;
+    writeIndexHeader();
+    close();
 }
 
-// Удалить последний элемент (pop_back)
-template <class T>
-void BinaryList<T>::pop_back() {
-    if (fh.size == 0) {
-        std::cout << "[T] Список пуст (pop_back)\n";
-        return;
-    }
-    erase(fh.size - 1);
+int HashIndexFile::storedGen() const {
+    return loadedGen;
 }
 
-// Дополнительно: удалить первый элемент (pop_front)
-// (если хотим логику очереди, где удаление идёт с "головы")
-template <class T>
-void BinaryList<T>::pop_front() {
-    if (fh.size == 0) {
-        std::cout << "[T] Список пуст (pop_front)\n";
-        return;
-    }
-    erase(0);
+void HashIndexFile::writeIndexHeader() {
+    seekp(0, std::ios::beg);
+    write(reinterpret_cast<const char*>(&hh), sizeof(hh));
 }
 
-// Очистить весь список (clear)
-template <class T>
-void BinaryList<T>::clear() {
-    if (is_open()) {
-        close();
-    }
-    std::remove(fname.c_str()); // удаляем файл
-    // Создаём заново
-    std::ofstream ff(fname.c_str(), std::ios::binary);
-    ff.close();
-    open(fname.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+HashSlot HashIndexFile::readSlot(int i) {
+    HashSlot s;
+    seekg(sizeof(hh) + (std::streamoff)i * sizeof(HashSlot), std::ios::beg);
+    read(reinterpret_cast<char*>(&s), sizeof(HashSlot));
+    return s;
+}
 
-    // Пустой заголовок
-    fh.head = -1;
-    fh.tail = -1;
-    fh.size = 0;
-    writeHeader();
+void HashIndexFile::writeSlot(int i, const HashSlot& s) {
+    seekp(sizeof(hh) + (std::streamoff)i * sizeof(HashSlot), std::ios::beg);
+    write(reinterpret_cast<const char*>(&s), sizeof(HashSlot));
 }
 
-// Печать всего списка (print)
-template <class T>
-void BinaryList<T>::print() {
-    if (fh.size == 0) {
-        std::cout << "[T] Список пуст.\n";
-        return;
-    }
-    std::cout << "[T] Содержимое списка (size=" << fh.size << "):\n";
-    int cur = fh.head;
-    for (int i = 0; i < fh.size; i++) {
-        seekg(cur, std::ios::beg);
-        int p, n;
-        T val{};
-        read(reinterpret_cast<char*>(&p), sizeof(int));
-        read(reinterpret_cast<char*>(&n), sizeof(int));
-        read(reinterpret_cast<char*>(&val), sizeof(T));
-        std::cout << "  [" << i << "]: " << val << "\n";
-        cur = n;
+// Построить таблицу целиком в памяти и записать одним блоком
+void HashIndexFile::rebuild(const std::vector<HashSlot>& entries) {
+    int cap = 16;
+    while ((long long)cap * 7 < (long long)entries.size() * 10 + 10) cap *= 2;
+    std::vector<HashSlot> table(cap, HashSlot{0, SLOT_EMPTY});
+    for (const HashSlot& e : entries) {
+        int i = (int)(e.hash & (cap - 1));
+        while (table[i].pos != SLOT_EMPTY) i = (i + 1) & (cap - 1);
+        table[i] = e;
     }
+    hh.capacity = cap;
+    hh.used = (int)entries.size();
+    hh.live = (int)entries.size();
+    writeIndexHeader();
+    write(reinterpret_cast<const char*>(table.data()), (std::streamsize)cap * sizeof(HashSlot));
 }
 
-template <class T>
-int BinaryList<T>::getSize() const {
-    return fh.size;
+// Заполнение больше 70% — перестраиваем: живых много — вдвое больше
+// слотов, иначе на том же месте, просто без удалённых записей
+void HashIndexFile::grow() {
+    std::vector<HashSlot> table(hh.capacity);
+    seekg(sizeof(hh), std::ios::beg);
+    read(reinterpret_cast<char*>(table.data()), (std::streamsize)hh.capacity * sizeof(HashSlot));
+    std::vector<HashSlot> entries;
+    entries.reserve(hh.live);
+    for (const HashSlot& s : table) {
+        if (s.pos >= 0) entries.push_back(s);
+    }
+    rebuild(entries);
 }
 
-// Сортировка (пузырьковая) прямо в файле — допустимо ТОЛЬКО для POD фиксированной длины!
-template <class T>
-void BinaryList<T>::sort() {
-    if (fh.size <= 1) {
-        std::cout << "[T] Список пуст или 1 элемент, сортировать нечего.\n";
-        return;
+void HashIndexFile::add(unsigned hash, int pos) {
+    if (hh.capacity == 0 || (long long)(hh.used + 1) * 10 > (long long)hh.capacity * 7) {
+        if (hh.capacity == 0) rebuild(std::vector<HashSlot>());
+        else grow();
     }
-    bool swapped;
-    do {
-        swapped = false;
-        int curPos = fh.head;
-        for (int i = 0; i < fh.size - 1; i++) {
-            // Считываем next
-            seekg(curPos + sizeof(int), std::ios::beg);
-            int nextPos;
-            read(reinterpret_cast<char*>(&nextPos), sizeof(int));
-
-            // читаем curVal, nextVal
-            T curVal{}, nextVal{};
-            seekg(curPos + 2 * sizeof(int), std::ios::beg);
-            read(reinterpret_cast<char*>(&curVal), sizeof(T));
-            seekg(nextPos + 2 * sizeof(int), std::ios::beg);
-            read(reinterpret_cast<char*>(&nextVal), sizeof(T));
-
-            if (curVal > nextVal) {
-                // Меняем их местами прямо в файле
-                seekp(curPos + 2 * sizeof(int), std::ios::beg);
-                write(reinterpret_cast<char*>(&nextVal), sizeof(T));
-                seekp(nextPos + 2 * sizeof(int), std::ios::beg);
-                write(reinterpret_cast<char*>(&curVal), sizeof(T));
-                swapped = true;
-            }
-            curPos = nextPos;
+    int i = (int)(hash & (hh.capacity - 1));
+    while (true) {
+        HashSlot s = readSlot(i);
+        if (s.pos == SLOT_EMPTY || s.pos == SLOT_DELETED) {
+            if (s.pos == SLOT_EMPTY) hh.used++;
+            writeSlot(i, HashSlot{hash, pos});
+            hh.live++;
+            return;
         }
-    } while (swapped);
-    std::cout << "[T] Список отсортирован.\n";
+        i = (i + 1) & (hh.capacity - 1);
+    }
 }
 
-// Итератор
-template <class T>
-void BinaryList<T>::initIterator() {
-    iterPos = fh.head;
+void HashIndexFile::remove(unsigned hash, int pos) {
+    if (hh.capacity == 0) return;
+    int i = (int)(hash & (hh.capacity - 1));
+    while (true) {
+        HashSlot s = readSlot(i);
+        if (s.pos == SLOT_EMPTY) return;
+        if (s.pos == pos && s.hash == hash) {
+            writeSlot(i, HashSlot{hash, SLOT_DELETED});
+            hh.live--;
+            return;
+        }
+        i = (i + 1) & (hh.capacity - 1);
+    }
 }
 
-template <class T>
-bool BinaryList<T>::hasNext() {
-    return (iterPos != -1);
+template <class Check>
+bool HashIndexFile::lookup(unsigned hash, Check check) {
+    if (hh.capacity == 0) return false;
+    int i = (int)(hash & (hh.capacity - 1));
+    while (true) {
+        HashSlot s = readSlot(i);
+        if (s.pos == SLOT_EMPTY) return false;
+        if (s.pos >= 0 && s.hash == hash && check(s.pos)) return true;
+        i = (i + 1) & (hh.capacity - 1);
+    }
 }
 
-template <class T>
-T BinaryList<T>::next() {
-    T res{};
-    if (iterPos == -1) return res;
-    seekg(iterPos, std::ios::beg);
-    int p, n;
-    read(reinterpret_cast<char*>(&p), sizeof(int));
-    read(reinterpret_cast<char*>(&n), sizeof(int));
-    read(reinterpret_cast<char*>(&res), sizeof(T));
-    iterPos = n;
-    return res;
-}
+//-----------------------------------------------------
+// Фильтр Блума BloomFilter (спутник списка: fname.bloom)
+//   [ BloomHeader ][ биты ]
+// Биты целиком живут в памяти: отрицательный ответ на contains()
+// не трогает файл списка. На диск фильтр пишется при закрытии
+// вместе с поколением списка; если поколение не совпало (список
+// меняли без фильтра или программа упала) — фильтр перестраивается.
+//-----------------------------------------------------
+const int BLOOM_MAGIC = 0x4D4F4C42;  // "BLOM"
 
-//--------------------------------------------------------------
-// 2) Полная специализация BinaryList<std::string>
-//    (т.к. std::string имеет переменную длину)
-//--------------------------------------------------------------
-template <>
-class BinaryList<std::string> : public std::fstream {
-private:
-    FileHeader fh;
-    std::string fname;
-    int iterPos;  // для итератора (позиция узла или -1)
+struct BloomHeader {
+    int magic;
+    int bits;      // размер битового массива (кратен 64)
+    int hashes;    // число хеш-функций k
+    int capacity;  // на сколько ключей рассчитан (ошибка ~1%)
+    int count;     // добавлено ключей
+    int removed;   // удалено ключей (биты при этом не снимаются)
+    int gen;       // поколение списка (FileHeader::gen)
+};
 
+class BloomFilter {
 public:
-    BinaryList(const std::string& filename);
-    ~BinaryList();
-
-    void push_back(const std::string& value);
-    void insert(int index, const std::string& value);
-    void erase(int index);
-    std::string get(int index);
-
-    // ВАЖНО! update и sort для string делаем через «перечитывание всего в память»,
-    // чтобы избежать проблем с "затиранием" соседних узлов при увеличении длины строки.
-    void update(int index, const std::string& value);
-    void sort();
+    BloomFilter();
 
-    void pop_back();
-    void pop_front();
-    void clear();
-    void print();
-    int  getSize() const;
+    bool load(const std::string& filename);  // false — нет файла или он битый
+    void save(const std::string& filename, int gen);
+    int  storedGen() const;
 
-    // Итератор
-    void initIterator();
-    bool hasNext();
-    std::string next();
+    void reset(int expected);
+    void add(unsigned hash);
+    void noteRemoved(int n = 1);
+    bool mayContain(unsigned hash) const;
+    // Переполнен или засорён удалёнными ключами — пора перестроить
+    bool needsRebuild() const;
 
 private:
-    void readHeader();
-    void writeHeader();
+    BloomHeader bh;
+    std::vector<unsigned long long> words;
 
-    // Запись/чтение строки (сначала int len, потом len байт)
-    void writeString(const std::string& s);
-    std::string readString();
-
-    // Вспомогательный метод: «перечитать всё, изменить, переписать файл»
-    // Используется из update(...) и sort(...)
-    void rewriteAllFromVector(const std::vector<std::string>& vec);
+    unsigned second(unsigned hash) const;
 };
 
-//-----------------------------------------------------
-// Реализация BinaryList<std::string>
-//-----------------------------------------------------
-BinaryList<std::string>::BinaryList(const std::string& filename)
-    : std::fstream(), fname(filename), iterPos(-1)
-{
-    open(fname.c_str(), std::ios::in | std::ios::out | std::ios::binary);
-    if (!is_open()) {
-        // создаём
-        std::ofstream ff(fname.c_str(), std::ios::binary);
-        ff.close();
-        open(fname.c_str(), std::ios::in | std::ios::out | std::ios::binary);
-    }
-    if (is_open()) {
-        seekg(0, std::ios::end);
-        std::streamoff sz = tellg();
-        if (sz < (std::streamoff)sizeof(FileHeader)) {
-            fh.head = -1;
-            fh.tail = -1;
-            fh.size = 0;
-            writeHeader();
-        }
-        else {
-            readHeader();
-        }
+BloomFilter::BloomFilter() {
+    std::memset(&bh, 0, sizeof(bh));
+}
+
+bool BloomFilter::load(const std::string& filename) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(&bh), sizeof(bh))
+        || bh.magic != BLOOM_MAGIC || bh.bits <= 0 || bh.bits % 64 != 0 || bh.hashes <= 0) {
+        std::memset(&bh, 0, sizeof(bh));
+        words.clear();
+        return false;
     }
-    else {
-        fh.head = -1;
-        fh.tail = -1;
-        fh.size = 0;
+    words.assign(bh.bits / 64, 0);
+    if (!in.read(reinterpret_cast<char*>(words.data()), (std::streamsize)words.size() * 8)) {
+        std::memset(&bh, 0, sizeof(bh));
+        words.clear();
+        return false;
     }
+    return true;
 }
 
-BinaryList<std::string>::~BinaryList() {
-    if (is_open()) {
-        close();
-    }
+void BloomFilter::save(const std::string& filename, int gen) {
+    bh.gen = gen;
+    std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&bh), sizeof(bh));
+    out.write(reinterpret_cast<const char*>(words.data()), (std::streamsize)words.size() * 8);
 }
 
-void BinaryList<std::string>::readHeader() {
-    seekg(0, std::ios::beg);
-    read(reinterpret_cast<char*>(&fh), sizeof(FileHeader));
+int BloomFilter::storedGen() const {
+    return bh.gen;
 }
 
-void BinaryList<std::string>::writeHeader() {
-    seekp(0, std::ios::beg);
-    write(reinterpret_cast<const char*>(&fh), sizeof(FileHeader));
+// m = -n ln(p) / ln(2)^2 ~ 9.6 бит на ключ при p = 1%, k = 7
+void BloomFilter::reset(int expected) {
+    if (expected < 1024) expected = 1024;
+    long long bits = ((long long)expected * 96 / 10 + 63) / 64 * 64;
+    bh.magic = BLOOM_MAGIC;
+    bh.bits = (int)bits;
+    bh.hashes = 7;
+    bh.capacity = expected;
+    bh.count = 0;
+    bh.removed = 0;
+    words.assign((size_t)(bits / 64), 0);
 }
 
-void BinaryList<std::string>::writeString(const std::string& s) {
-    int len = (int)s.size();
-    write(reinterpret_cast<char*>(&len), sizeof(int));
-    write(s.c_str(), len);
+// Двойное хеширование: i-я функция = h1 + i * h2
+unsigned BloomFilter::second(unsigned hash) const {
+    unsigned h = hash;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h | 1u;
 }
 
-std::string BinaryList<std::string>::readString() {
-    int len;
-    read(reinterpret_cast<char*>(&len), sizeof(int));
-    if (len < 0 || len > 1000000) {
-        // простой safeguard
-        return "";
+void BloomFilter::add(unsigned hash) {
+    if (words.empty()) return;
+    unsigned h2 = second(hash);
+    for (int i = 0; i < bh.hashes; i++) {
+        unsigned bit = (hash + (unsigned)i * h2) % (unsigned)bh.bits;
+        words[bit / 64] |= 1ull << (bit % 64);
     }
-    std::string temp(len, '\0');
-    read(&temp[0], len);
-    return temp;
+    bh.count++;
 }
 
-// Добавляем в конец (push_back)
-void BinaryList<std::string>::push_back(const std::string& value) {
-    if (!is_open()) return;
-    seekp(0, std::ios::end);
-    long newPos = tellp();
-
-    int prev = fh.tail;
-    int next = -1;
-    seekp(newPos, std::ios::beg);
-    write(reinterpret_cast<char*>(&prev), sizeof(int));
-    write(reinterpret_cast<char*>(&next), sizeof(int));
-    writeString(value);
+void BloomFilter::noteRemoved(int n) {
+    bh.removed += n;
+}
 
-    if (fh.size == 0) {
-        fh.head = (int)newPos;
-        fh.tail = (int)newPos;
-        fh.size = 1;
-        writeHeader();
-    }
-    else {
-        // обновляем next у прежнего tail
-        if (fh.tail != -1) {
-            seekp(fh.tail + sizeof(int), std::ios::beg);
-            int np = (int)newPos;
-            write(reinterpret_cast<char*>(&np), sizeof(int));
-        }
-        fh.tail = (int)newPos;
-        fh.size++;
-        writeHeader();
+bool BloomFilter::mayContain(unsigned hash) const {
+    if (words.empty()) return true;
+    unsigned h2 = second(hash);
+    for (int i = 0; i < bh.hashes; i++) {
+        unsigned bit = (hash + (unsigned)i * h2) % (unsigned)bh.bits;
+        if (!(words[bit / 64] & (1ull << (bit % 64)))) return false;
     }
+    return true;
 }
 
-// Вставка по индексу
-void BinaryList<std::string>::insert(int index, const std::string& value) {
-    if (!is_open()) return;
-    if (index < 0 || index > fh.size) {
-        std::cout << "[string] Неверный индекс insert: " << index << "\n";
-        return;
-    }
-    // Если вставка в конец
-    if (index == fh.size) {
-        push_back(value);
-        return;
-    }
-    // Если вставка в начало
-    if (index == 0) {
-        seekp(0, std::ios::end);
-        long newPos = tellp();
-        int prev = -1;
-        int next = fh.head;
-        seekp(newPos, std::ios::beg);
-        write(reinterpret_cast<char*>(&prev), sizeof(int));
-        write(reinterpret_cast<char*>(&next), sizeof(int));
-        writeString(value);
+bool BloomFilter::needsRebuild() const {
+    return words.empty() || bh.count > bh.capacity || bh.removed * 2 > bh.count + 1024;
+}
 
-        if (fh.head != -1) {
-            // старому head -> prev = newPos
-            seekp(fh.head, std::ios::beg);
-            write(reinterpret_cast<char*>(&newPos), sizeof(int));
-        }
-        fh.head = (int)newPos;
-        if (fh.size == 0) {
-            fh.tail = (int)newPos;
-        }
-        fh.size++;
-        writeHeader();
-        return;
-    }
+//-----------------------------------------------------
+// Пул рабочих потоков WorkerPool
+//   run(count, job) выполняет job(0..count-1) на потоках пула
+//   и ждёт завершения. Вызывающий поток тоже берёт задачи
+//   из очереди, поэтому вложенный run() не блокирует пул.
+//   post(task) ставит задачу без ожидания.
+//-----------------------------------------------------
+class WorkerPool {
+public:
+    explicit WorkerPool(int threads);
+    ~WorkerPool();
 
-    // Иначе вставка в середину
-    int curPos = fh.head;
-    for (int i = 0; i < index; i++) {
-        seekg(curPos + sizeof(int), std::ios::beg); // curPos + 4 => next
-        read(reinterpret_cast<char*>(&curPos), sizeof(int));
-    }
-    // curPos — позиция узла с индексом index (который сдвинется вправо)
-    int oldPrev;
-    seekg(curPos, std::ios::beg);
-    read(reinterpret_cast<char*>(&oldPrev), sizeof(int)); // prev
+    static WorkerPool& shared();  // общий пул: по потоку на ядро
+    static WorkerPool& io();      // пул ввода-вывода: два своих потока
 
-    // Новый узел
-    seekp(0, std::ios::end);
-    long newN = tellp();
-    int newPrev = oldPrev;
-    int newNext = curPos;
-    write(reinterpret_cast<char*>(&newPrev), sizeof(int));
-    write(reinterpret_cast<char*>(&newNext), sizeof(int));
-    writeString(value);
-
-    // теперь у узла curPos поле prev = newN
-    seekp(curPos, std::ios::beg);
-    write(reinterpret_cast<char*>(&newN), sizeof(int));
-
-    // у узла oldPrev поле next = newN
-    if (oldPrev != -1) {
-        seekp(oldPrev + sizeof(int), std::ios::beg);
-        int tmp = (int)newN;
-        write(reinterpret_cast<char*>(&tmp), sizeof(int));
+    int  size() const;            // потоков, включая вызывающий
+    void run(int count, const std::function<void(int)>& job);
+    void post(std::function<void()> task);
+
+private:
+    void loop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex m;
+    std::condition_variable cv;      // появились задачи / остановка
+    std::condition_variable doneCv;  // какая-то задача завершилась
+    bool stop;
+};
+
+WorkerPool::WorkerPool(int threads) : stop(false) {
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(&WorkerPool::loop, this);
     }
-    fh.size++;
-    writeHeader();
 }
 
-// Удаление по индексу
-void BinaryList<std::string>::erase(int index) {
-    if (!is_open()) return;
-    if (index < 0 || index >= fh.size || fh.size == 0) {
-        std::cout << "[string] Неверный индекс erase: " << index << "\n";
-        return;
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lk(m);
+        stop = true;
     }
-    int curPos = fh.head;
-    for (int i = 0; i < index; i++) {
-        seekg(curPos + sizeof(int), std::ios::beg);
-        read(reinterpret_cast<char*>(&curPos), sizeof(int));
+    cv.notify_all();
+    for (auto& t : workers) {
+        t.join();
     }
-    int p, n;
-    seekg(curPos, std::ios::beg);
-    read(reinterpret_cast<char*>(&p), sizeof(int));  // prev
-    read(reinterpret_cast<char*>(&n), sizeof(int));  // next
+}
 
-    // если удаляем head
-    if (curPos == fh.head) {
-        fh.head = n;
-    }
-    // если удаляем tail
-    if (curPos == fh.tail) {
-        fh.tail = p;
-    }
-    // p->next = n
-    if (p != -1) {
-        seekp(p + sizeof(int), std::ios::beg);
-        write(reinterpret_cast<char*>(&n), sizeof(int));
-    }
-    // n->prev = p
-    if (n != -1) {
-        seekp(n, std::ios::beg);
-        write(reinterpret_cast<char*>(&p), sizeof(int));
-    }
-    fh.size--;
-    writeHeader();
+WorkerPool& WorkerPool::shared() {
+    static WorkerPool pool((int)std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
 }
 
-// Получение элемента по индексу
-std::string BinaryList<std::string>::get(int index) {
-    if (!is_open()) return "";
-    if (index < 0 || index >= fh.size) {
-        std::cout << "[string] Неверный индекс get: " << index << "\n";
-        return "";
-    }
-    int cur = fh.head;
-    for (int i = 0; i < index; i++) {
-        seekg(cur + sizeof(int), std::ios::beg);
-        read(reinterpret_cast<char*>(&cur), sizeof(int));
+// Отдельно от вычислительного пула: ожидание диска не занимает потоки
+// sort/mergeFiles, а рабочие потоки есть и на одном ядре, так что
+// post никогда не выполняет задачу на месте
+WorkerPool& WorkerPool::io() {
+    static WorkerPool pool(3);
+    return pool;
+}
+
+int WorkerPool::size() const {
+    return (int)workers.size() + 1;
+}
+
+void WorkerPool::loop() {
+    std::unique_lock<std::mutex> lk(m);
+    while (true) {
+        cv.wait(lk, [this] { return stop || !tasks.empty(); });
+        if (tasks.empty()) return;  // stop и задач не осталось
+        std::function<void()> task = std::move(tasks.front());
+        tasks.pop_front();
+        lk.unlock();
+        task();
+        lk.lock();
     }
-    // пропускаем поля prev и next
-    seekg(cur + 2 * sizeof(int), std::ios::beg);
-    return readString();
 }
 
-// ВАЖНО: update для string делаем «через вектор»
-void BinaryList<std::string>::update(int index, const std::string& value) {
-    if (!is_open()) return;
-    if (index < 0 || index >= fh.size) {
-        std::cout << "[string] Неверный индекс update: " << index << "\n";
+// Без рабочих потоков (одно ядро) задачу некому взять — выполняем сразу
+void WorkerPool::post(std::function<void()> task) {
+    if (workers.empty()) {
+        task();
         return;
     }
-    // 1) Считаем всё в память
-    std::vector<std::string> temp;
-    temp.reserve(fh.size);
-    int cur = fh.head;
-    for (int i = 0; i < fh.size; i++) {
-        seekg(cur, std::ios::beg);
-        int p, n;
-        read(reinterpret_cast<char*>(&p), sizeof(int));
-        read(reinterpret_cast<char*>(&n), sizeof(int));
-        std::string s = readString();
-        temp.push_back(s);
-        cur = n;
+    {
+        std::lock_guard<std::mutex> lk(m);
+        tasks.push_back(std::move(task));
     }
-    // 2) Меняем нужный элемент
-    temp[index] = value;
-    // 3) Полностью переписываем файл
-    rewriteAllFromVector(temp);
+    cv.notify_one();
 }
 
-// Сортировка «через вектор»
-void BinaryList<std::string>::sort() {
-    if (fh.size <= 1) {
-        std::cout << "[string] Список пуст или 1 элемент, сортировать нечего.\n";
-        return;
+void WorkerPool::run(int count, const std::function<void(int)>& job) {
+    int left = count;
+    std::unique_lock<std::mutex> lk(m);
+    for (int i = 0; i < count; i++) {
+        tasks.push_back([this, &job, &left, i] {
+            job(i);
+            std::lock_guard<std::mutex> g(m);
+            if (--left == 0) doneCv.notify_all();
+        });
     }
-    // 1) Считываем всё в память
-    std::vector<std::string> temp;
-    temp.reserve(fh.size);
-    int cur = fh.head;
-    for (int i = 0; i < fh.size; i++) {
-        seekg(cur, std::ios::beg);
-        int p, n;
-        read(reinterpret_cast<char*>(&p), sizeof(int));
-        read(reinterpret_cast<char*>(&n), sizeof(int));
-        std::string s = readString();
-        temp.push_back(s);
-        cur = n;
+    cv.notify_all();
+    // Пока ждём — помогаем выполнять задачи
+    while (left > 0) {
+        if (!tasks.empty()) {
+            std::function<void()> task = std::move(tasks.front());
+            tasks.pop_front();
+            lk.unlock();
+            task();
+            lk.lock();
+        }
+        else {
+            doneCv.wait(lk);
+        }
     }
-    // 2) Сортируем в памяти
-    std::sort(temp.begin(), temp.end());
-    // 3) Переписываем файл
-    rewriteAllFromVector(temp);
-    std::cout << "[string] Список отсортирован.\n";
 }
 
-// Вспомогательный метод: перезаписать всё из вектора
-void BinaryList<std::string>::rewriteAllFromVector(const std::vector<std::string>& vec) {
-    // Сначала clear()
-    if (is_open()) {
-        close();
+// Параллельная сортировка на общем пуле: куски сортируются std::sort
+// независимо, затем соседние куски сливаются парами (inplace_merge),
+// все пары одного круга — параллельно
+template <class It, class Less>
+void parallelSort(It first, It last, Less less) {
+    WorkerPool& pool = WorkerPool::shared();
+    long long n = last - first;
+    const long long MIN_PART = 1 << 14;  // мельче дробить нет смысла
+    int parts = (int)std::min<long long>(pool.size(), n / MIN_PART);
+    if (parts <= 1) {
+        std::sort(first, last, less);
+        return;
     }
-    std::remove(fname.c_str());
-    {
-        std::ofstream ff(fname.c_str(), std::ios::binary);
-        ff.close();
+    std::vector<It> bounds(parts + 1);
+    for (int k = 0; k <= parts; k++) {
+        bounds[k] = first + n * k / parts;
     }
-    open(fname.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    pool.run(parts, [&](int k) { std::sort(bounds[k], bounds[k + 1], less); });
+    for (int width = 1; width < parts; width *= 2) {
+        int pairs = (parts + 2 * width - 1) / (2 * width);
+        pool.run(pairs, [&](int p) {
+            int a = p * 2 * width;
+            int mid = std::min(a + width, parts);
+            int end = std::min(a + 2 * width, parts);
+            if (mid < end) std::inplace_merge(bounds[a], bounds[mid], bounds[end], less);
+        });
+    }
+}
 
-    // Пустой заголовок
-    fh.head = -1;
-    fh.tail = -1;
-    fh.size = 0;
-    writeHeader();
+//-----------------------------------------------------
+// Асинхронный движок ввода-вывода IoEngine
+//   Пакет запросов «прочитать/записать len байт по смещению pos»
+//   выполняется пулом WorkerPool: запросы, лежащие в файле встык,
+//   склеиваются в один, остальные идут параллельно, так что на
+//   диске одновременно находится много запросов, а не один.
+//   На POSIX потоки делят один дескриптор (pread/pwrite),
+//   в остальных системах каждая задача открывает свой поток.
+//-----------------------------------------------------
+struct IoRequest {
+    int   pos;  // смещение в файле
+    int   len;  // сколько байт
+    char* buf;  // куда читать / откуда писать
+};
 
-    // Теперь заново записываем все строки push_back-ом
-    for (auto& s : vec) {
-        push_back(s);
-    }
+class IoEngine {
+public:
+    IoEngine();
+    ~IoEngine();
+
+    bool open(const std::string& filename);
+    void close();
+    bool isOpen() const;
+
+    // Возвращаются, когда выполнен весь пакет; false — ошибка ввода-вывода
+    bool readBatch(std::vector<IoRequest>& batch);
+    bool writeBatch(std::vector<IoRequest>& batch);
+
+private:
+    std::string name;
+    bool opened;
+#if BL_HAVE_PREAD
+    int fd;
+#endif
+
+    bool submit(std::vector<IoRequest>& batch, bool isWrite);
+};
+
+IoEngine::IoEngine() : opened(false) {
+#if BL_HAVE_PREAD
+    fd = -1;
+#endif
 }
 
-// pop_back
-void BinaryList<std::string>::pop_back() {
-    if (fh.size == 0) {
-        std::cout << "[string] Список пуст (pop_back)\n";
-        return;
-    }
-    erase(fh.size - 1);
+IoEngine::~IoEngine() {
+    close();
 }
 
-// pop_front
-void BinaryList<std::string>::pop_front() {
-    if (fh.size == 0) {
-        std::cout << "[string] Список пуст (pop_front)\n";
-        return;
-    }
-    erase(0);
+bool IoEngine::open(const std::string& filename) {
+    close();
+    name = filename;
+#if BL_HAVE_PREAD
+    fd = ::open(filename.c_str(), O_RDWR);
+    opened = (fd >= 0);
+#else
+    std::ifstream probe(filename.c_str(), std::ios::binary);
+    opened = probe.is_open();
+#endif
+    return opened;
 }
 
-// clear
-void BinaryList<std::string>::clear() {
-    if (is_open()) {
-        close();
+void IoEngine::close() {
+#if BL_HAVE_PREAD
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
     }
-    std::remove(fname.c_str());
+#endif
+    opened = false;
+}
+
+bool IoEngine::isOpen() const {
+    return opened;
+}
+
+bool IoEngine::readBatch(std::vector<IoRequest>& batch) {
+    return submit(batch, false);
+}
+
+bool IoEngine::writeBatch(std::vector<IoRequest>& batch) {
+    return submit(batch, true);
+}
+
+bool IoEngine::submit(std::vector<IoRequest>& batch, bool isWrite) {
+    if (!opened) return false;
+    if (batch.empty()) return true;
+
+    // Склеиваем запросы, идущие встык: span — отрезок файла
+    // и номера запросов [from, to) в отсортированном порядке
+    std::vector<int> order(batch.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+    std::sort(order.begin(), order.end(),
+              [&](int a, int b) { return batch[a].pos < batch[b].pos; });
+    struct Span { int pos, len, from, to; };
+    std::vector<Span> spans;
+    for (size_t i = 0; i < order.size(); i++) {
+        const IoRequest& r = batch[order[i]];
+        if (!spans.empty() && spans.back().pos + spans.back().len == r.pos) {
+            spans.back().len += r.len;
+            spans.back().to++;
+        }
+        else {
+            spans.push_back(Span{ r.pos, r.len, (int)i, (int)i + 1 });
+        }
+    }
+
+    WorkerPool& pool = WorkerPool::shared();
+    int parts = std::min((int)spans.size(), pool.size() * 4);
+    std::vector<char> failed(parts, 0);
+    pool.run(parts, [&](int k) {
+#if !BL_HAVE_PREAD
+        std::fstream f(name.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+        if (!f.is_open()) { failed[k] = 1; return; }
+#endif
+        std::vector<char> stage;
+        for (size_t s = k; s < spans.size(); s += parts) {
+            const Span& sp = spans[s];
+            // Одиночный запрос — прямо в буфер вызывающего,
+            // склеенный — через промежуточный буфер
+            char* p = batch[order[sp.from]].buf;
+            if (sp.to - sp.from > 1) {
+                stage.resize(sp.len);
+                p = stage.data();
+                if (isWrite) {
+                    int off = 0;
+                    for (int i = sp.from; i < sp.to; i++) {
+                        const IoRequest& r = batch[order[i]];
+                        std::memcpy(p + off, r.buf, r.len);
+                        off += r.len;
+                    }
+                }
+            }
+#if BL_HAVE_PREAD
+            int done = 0;
+            while (done < sp.len) {
+                ssize_t n = isWrite ? ::pwrite(fd, p + done, sp.len - done, sp.pos + done)
+                                    : ::pread(fd, p + done, sp.len - done, sp.pos + done);
+                if (n <= 0) { failed[k] = 1; break; }
+                done += (int)n;
+            }
+#else
+            if (isWrite) {
+                f.seekp(sp.pos, std::ios::beg);
+                f.write(p, sp.len);
+            }
+            else {
+                f.seekg(sp.pos, std::ios::beg);
+                f.read(p, sp.len);
+            }
+            if (!f) { failed[k] = 1; f.clear(); }
+#endif
+            if (!isWrite && sp.to - sp.from > 1) {
+                int off = 0;
+                for (int i = sp.from; i < sp.to; i++) {
+                    const IoRequest& r = batch[order[i]];
+                    std::memcpy(r.buf, p + off, r.len);
+                    off += r.len;
+                }
+            }
+        }
+    });
+    for (char f : failed) {
+        if (f) return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------
+// Состояние снимка (MVCC) — общее для BinaryList и ListSnapshot
+//   Пока снимок закреплён, список перед каждой записью «на место»
+//   (ссылки узлов, данные фиксированного размера) сохраняет прежние
+//   байты в before-карту снимка. Новые узлы пишутся в конец файла,
+//   поэтому в версии снимка их просто нет.
+//-----------------------------------------------------
+template <class T>
+struct SnapshotState {
+    FileHeader fh;                      // версия списка, которую видит снимок
+    int fileEnd;                        // длина файла при создании снимка
+    std::map<int, std::string> before;  // позиция -> прежние байты
+    bool detached;                      // файл списка заменён целиком
+    bool frozenOn;                      // значения сохранены в frozen
+    std::vector<T> frozen;
+};
+
+// Реестр закреплённых снимков одного списка; живёт, пока жив
+// список или хотя бы один его снимок
+template <class T>
+struct SnapshotHub {
+    std::mutex m;
+    std::atomic<int> count{0};  // быстрый путь записи без снимков
+    std::vector<SnapshotState<T>*> pinned;
+};
+
+// Наложить сохранённые прежние байты на прочитанный отрезок
+// [pos, pos + len). Вызывается под SnapshotHub::m.
+template <class T>
+void snapshotPatch(const SnapshotState<T>& st, int pos, char* buf, int len) {
+    auto it = st.before.upper_bound(pos);
+    if (it != st.before.begin()) --it;
+    for (; it != st.before.end() && it->first < pos + len; ++it) {
+        int from = std::max(pos, it->first);
+        int to = std::min(pos + len, it->first + (int)it->second.size());
+        if (from < to) {
+            std::memcpy(buf + (from - pos), it->second.data() + (from - it->first), to - from);
+        }
+    }
+}
+
+template <class T> class ListSnapshot;
+
+//-----------------------------------------------------
+// Канал ожидания WaitChannel — один на имя файла в процессе.
+//   Каждая запись заголовка списка увеличивает seq и, если кто-то
+//   ждёт, будит его. Записи других процессов приходят через
+//   inotify (Linux): поток-наблюдатель, запускаемый при первом
+//   ожидании, превращает IN_MODIFY в то же пробуждение. Без
+//   inotify ожидание перепроверяет файл каждую миллисекунду.
+//-----------------------------------------------------
+class WaitChannel {
+public:
+    static std::shared_ptr<WaitChannel> forFile(const std::string& path);
+    ~WaitChannel();
+
+    unsigned long long seq() const { return counter.load(); }
+    void notify();
+    // Спать, пока seq равен seen, но не дольше timeoutMs и одного
+    // среза опроса; true — seq изменился. Вызывающий перепроверяет
+    // условие и при необходимости ждёт снова.
+    bool wait(unsigned long long seen, int timeoutMs);
+
+private:
+    explicit WaitChannel(const std::string& p);
+    void startWatcher();  // под m
+    void watchLoop();
+
+    std::string path;
+    std::mutex m;
+    std::condition_variable cv;
+    std::atomic<unsigned long long> counter;
+    std::atomic<int> waiters;
+    std::atomic<bool> watchOk;  // inotify следит за файлом
+    std::atomic<bool> stopping; // деструктор ждёт выхода наблюдателя
+    std::thread watcher;
+    int inoFd;
+    int stopFd;
+};
+
+std::shared_ptr<WaitChannel> WaitChannel::forFile(const std::string& path) {
+    static std::mutex regM;
+    static std::map<std::string, std::weak_ptr<WaitChannel>> reg;
+    std::lock_guard<std::mutex> lk(regM);
+    std::shared_ptr<WaitChannel> ch = reg[path].lock();
+    if (!ch) {
+        for (auto it = reg.begin(); it != reg.end(); ) {
+            if (it->second.expired()) it = reg.erase(it);
+            else ++it;
+        }
+        ch.reset(new WaitChannel(path));
+        reg[path] = ch;
+    }
+    return ch;
+}
+
+WaitChannel::WaitChannel(const std::string& p)
+    : path(p), counter(0), waiters(0), watchOk(false), stopping(false), inoFd(-1), stopFd(-1) {}
+
+// Наблюдатель всегда дожидается join: дескрипторы и поля канала
+// закрываются только после его выхода. Если eventfd не разбудил
+// poll, поток сам заметит stopping по таймауту среза.
+WaitChannel::~WaitChannel() {
+#if BL_HAVE_INOTIFY
+    if (watcher.joinable()) {
+        stopping = true;
+        unsigned long long one = 1;
+        while (::write(stopFd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+        watcher.join();
+    }
+    if (inoFd >= 0) ::close(inoFd);
+    if (stopFd >= 0) ::close(stopFd);
+#endif
+}
+
+// Счётчик растёт всегда; мьютекс и notify — только при ждущих.
+// Ждущий увеличивает waiters до проверки counter, поэтому
+// хотя бы одна сторона видит запись другой.
+void WaitChannel::notify() {
+    counter++;
+    if (waiters.load() > 0) {
+        { std::lock_guard<std::mutex> lk(m); }
+        cv.notify_all();
+    }
+}
+
+bool WaitChannel::wait(unsigned long long seen, int timeoutMs) {
+    std::unique_lock<std::mutex> lk(m);
+    startWatcher();
+    waiters++;
+    int slice = watchOk ? 100 : 1;  // с inotify срез — только подстраховка
+    if (timeoutMs >= 0) slice = std::min(slice, timeoutMs);
+    bool changed = cv.wait_for(lk, std::chrono::milliseconds(slice),
+                               [&] { return counter.load() != seen; });
+    waiters--;
+    return changed;
+}
+
+void WaitChannel::startWatcher() {
+#if BL_HAVE_INOTIFY
+    const unsigned MASK = IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF;
+    if (inoFd < 0) {
+        inoFd = ::inotify_init1(IN_CLOEXEC);
+        stopFd = ::eventfd(0, EFD_CLOEXEC);
+        if (inoFd < 0 || stopFd < 0) return;
+        watchOk = ::inotify_add_watch(inoFd, path.c_str(), MASK) >= 0;
+        watcher = std::thread(&WaitChannel::watchLoop, this);
+    }
+    else if (!watchOk && stopFd >= 0) {
+        // файл был заменён (replaceFile) — следим за новым
+        watchOk = ::inotify_add_watch(inoFd, path.c_str(), MASK) >= 0;
+    }
+#endif
+}
+
+void WaitChannel::watchLoop() {
+#if BL_HAVE_INOTIFY
+    alignas(inotify_event) char buf[4096];
+    pollfd fds[2] = { { inoFd, POLLIN, 0 }, { stopFd, POLLIN, 0 } };
+    const int STOP_CHECK_MS = 500;  // подстраховка, если eventfd не сработал
+    while (!stopping.load()) {
+        int r = ::poll(fds, 2, STOP_CHECK_MS);
+        if (r <= 0) continue;
+        if (fds[1].revents) return;
+        if (!(fds[0].revents & POLLIN)) continue;
+        ssize_t n = ::read(inoFd, buf, sizeof(buf));
+        for (ssize_t off = 0; off < n; ) {
+            const inotify_event* ev = reinterpret_cast<const inotify_event*>(buf + off);
+            if (ev->mask & IN_IGNORED) watchOk = false;
+            off += sizeof(inotify_event) + ev->len;
+        }
+        notify();
+    }
+#endif
+}
+
+// Межпроцессная блокировка: flock на отдельном файле fname.lock
+// (сам файл списка может быть пересоздан replaceFile).
+// Без POSIX блокировка пустая — процессы там не поддерживаются.
+class FileLock {
+public:
+    explicit FileLock(const std::string& path);
+    ~FileLock();
+    void lock();
+    void unlock();
+
+private:
+    int fd;
+};
+
+FileLock::FileLock(const std::string& path) : fd(-1) {
+#if BL_HAVE_PREAD
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+#else
+    (void)path;
+#endif
+}
+
+FileLock::~FileLock() {
+#if BL_HAVE_PREAD
+    if (fd >= 0) ::close(fd);
+#endif
+}
+
+void FileLock::lock() {
+#if BL_HAVE_PREAD
+    if (fd >= 0) ::flock(fd, LOCK_EX);
+#endif
+}
+
+void FileLock::unlock() {
+#if BL_HAVE_PREAD
+    if (fd >= 0) ::flock(fd, LOCK_UN);
+#endif
+}
+
+// Копия файла без прохода данных через память процесса, если
+// система это умеет: reflink (FICLONE — копия делит блоки с
+// оригиналом до первой записи), иначе copy_file_range (копирование
+// в ядре); остаток — обычными чтением и записью блоками по 1 МБ
+enum CloneMethod { CM_FAILED, CM_REFLINK, CM_COPY_RANGE, CM_STREAM };
+
+const char* cloneMethodName(CloneMethod m) {
+    switch (m) {
+    case CM_REFLINK: return "reflink";
+    case CM_COPY_RANGE: return "copy_file_range";
+    case CM_STREAM: return "чтение/запись";
+    default: return "ошибка";
+    }
+}
+
+CloneMethod cloneFile(const std::string& src, const std::string& dst) {
+#if BL_HAVE_PREAD
+    int in = ::open(src.c_str(), O_RDONLY);
+    if (in < 0) return CM_FAILED;
+    int out = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        ::close(in);
+        return CM_FAILED;
+    }
+    off_t size = ::lseek(in, 0, SEEK_END);
+    off_t done = 0;
+    CloneMethod m = CM_STREAM;
+#if BL_HAVE_CLONE
+#ifdef FICLONE
+    if (::ioctl(out, FICLONE, in) == 0) {
+        done = size;
+        m = CM_REFLINK;
+    }
+#endif
+    if (m != CM_REFLINK) {
+        off_t inOff = 0, outOff = 0;
+        while (done < size) {
+            ssize_t n = ::copy_file_range(in, &inOff, out, &outOff, (size_t)(size - done), 0);
+            if (n <= 0) break;  // другая ФС, старое ядро — дальше сами
+            done += n;
+        }
+        if (done == size) m = CM_COPY_RANGE;
+    }
+#endif
+    std::vector<char> buf;
+    while (done < size) {
+        buf.resize((size_t)std::min<off_t>(1 << 20, size - done));
+        ssize_t n = ::pread(in, buf.data(), buf.size(), done);
+        if (n <= 0 || ::pwrite(out, buf.data(), (size_t)n, done) != n) {
+            m = CM_FAILED;
+            break;
+        }
+        done += n;
+    }
+    if (m != CM_FAILED && ::fsync(out) != 0) m = CM_FAILED;
+    ::close(in);
+    ::close(out);
+    return m;
+#else
+    std::ifstream in(src.c_str(), std::ios::binary);
+    std::ofstream out(dst.c_str(), std::ios::binary | std::ios::trunc);
+    if (!in || !out) return CM_FAILED;
+    out << in.rdbuf();
+    return out ? CM_STREAM : CM_FAILED;
+#endif
+}
+
+//-----------------------------------------------------
+// Отчёт о раскладке файла списка (BinaryList::analyze)
+//-----------------------------------------------------
+struct LayoutReport {
+    long long fileBytes;         // размер файла
+    long long liveBytes;         // байты живых узлов
+    long long padBytes;          // выравнивание между соседними слотами
+    long long deadBytes;         // мёртвые узлы (erase, перенесённые update)
+    int    nodes;
+    double avgJump;              // среднее |начало следующего - конец текущего|
+    long long maxJump;
+    double forwardFraction;      // доля переходов вперёд по файлу
+    double sequentialFraction;   // доля переходов в соседний слот
+    int    minLen, maxLen;       // длина данных узла (для строк — длина строки)
+    double avgLen;
+    int    lenHist[32];          // [0] — длина 0, [i] — длины в [2^(i-1), 2^i)
+    long long pagesTouched;      // смены 4 КиБ-страниц при обходе по порядку
+    long long idealPages;        // страниц, если бы живые узлы лежали подряд
+    bool   compactAdvised;
+};
+
+void printLayoutReport(const LayoutReport& r, const char* tag) {
+    std::cout << "[" << tag << "] Раскладка файла:\n"
+              << "  размер файла:      " << r.fileBytes << " байт\n"
+              << "  живые узлы:        " << r.nodes << " (" << r.liveBytes << " байт)\n"
+              << "  выравнивание:      " << r.padBytes << " байт\n"
+              << "  мёртвые байты:     " << r.deadBytes << "\n"
+              << "  переход (ср/макс): " << r.avgJump << " / " << r.maxJump << " байт\n"
+              << "  вперёд / подряд:   " << r.forwardFraction * 100 << "% / "
+              << r.sequentialFraction * 100 << "%\n"
+              << "  длина данных:      мин " << r.minLen << ", ср " << r.avgLen
+              << ", макс " << r.maxLen << "\n";
+    if (r.maxLen != r.minLen) {
+        std::cout << "  распределение длин:\n";
+        for (int i = 0; i < 32; i++) {
+            if (r.lenHist[i] == 0) continue;
+            int lo = i == 0 ? 0 : 1 << (i - 1);
+            int hi = i == 0 ? 0 : (1 << i) - 1;
+            std::cout << "    " << lo << ".." << hi << ": " << r.lenHist[i] << "\n";
+        }
+    }
+    std::cout << "  обход по порядку:  " << r.pagesTouched << " страниц 4 КиБ (минимум "
+              << r.idealPages << ")\n"
+              << "  уплотнение:        " << (r.compactAdvised ? "рекомендуется (compact)" : "не нужно")
+              << "\n";
+}
+
+//-----------------------------------------------------
+// Отчёт о целостности файла списка (BinaryList::verify)
+//-----------------------------------------------------
+struct VerifyReport {
+    int  nodes;          // узлов, достижимых от head
+    int  freeSlots;      // слотов в списке свободных (FileHeader::freeHead)
+    int  badLinks;       // prev не указывает на предыдущий узел, узел вне файла,
+                         // повтор позиции или пересечение узлов
+    int  badChecksums;   // узлы с неверной CRC данных (при HF_CHECKSUM)
+    bool checksums;      // в файле включены контрольные суммы
+    bool headerOk;       // CRC заголовка (без HF_CHECKSUM всегда true)
+    bool chainOk;        // цепочка дошла до -1 через size узлов и закончилась на tail
+
+    bool ok() const { return headerOk && chainOk && badLinks == 0 && badChecksums == 0; }
+};
+
+void printVerifyReport(const VerifyReport& r, const char* tag) {
+    std::cout << "[" << tag << "] Проверка целостности:\n"
+              << "  узлов по цепочке:  " << r.nodes << "\n"
+              << "  цепочка:           " << (r.chainOk ? "цела" : "нарушена") << "\n"
+              << "  ошибки связей:     " << r.badLinks << "\n";
+    if (r.freeSlots > 0) {
+        std::cout << "  свободные слоты:   " << r.freeSlots << "\n";
+    }
+    if (r.checksums) {
+        std::cout << "  заголовок (CRC):   " << (r.headerOk ? "ок" : "повреждён") << "\n"
+                  << "  ошибки CRC узлов:  " << r.badChecksums << "\n";
+    }
+    else {
+        std::cout << "  контрольные суммы: выключены\n";
+    }
+    std::cout << "  итог:              " << (r.ok() ? "ок" : "есть повреждения (rebuild)") << "\n";
+}
+
+//-----------------------------------------------------
+// Общее место файла-контейнера (ListContainer): все его списки
+// дописывают узлы в один общий конец. Размер файла для этого не
+// годится — соседний список мог выделить место и ещё не записать его.
+//-----------------------------------------------------
+struct ContainerSpace {
+    std::mutex m;
+    int end;  // первый байт за последним выделенным местом
+};
+
+class ListContainer;
+
+//-----------------------------------------------------
+//      1) Шаблон BinaryList<T>
+//   Раскладка узла задаётся NodeCodec<T>; для типов
+//   фиксированного размера используются быстрые пути
+//   (адресная арифметика, запись узла одним блоком).
+//-----------------------------------------------------
+template <class T>
+class BinaryList : public std::fstream {
+private:
+    typedef NodeCodec<T> Codec;
+
+    // Смещение данных внутри узла (после [prev][next])
+    static constexpr int LINKS = 2 * (int)sizeof(int);
+    // Полный размер узла для типов фиксированного размера
+    static constexpr int NODE_SIZE = Codec::fixedSize ? LINKS + Codec::size : 0;
+
+    FileHeader fh;         // Заголовок списка (в памяти)
+    std::string fname;     // Имя файла (у списка в контейнере — «контейнер#имя», для спутников)
+    std::string path;      // Файл с узлами (у списка в контейнере — файл контейнера)
+    int base;              // Позиция заголовка в файле: 0 или запись каталога контейнера
+    std::shared_ptr<ContainerSpace> space;  // общий конец контейнера (null — свой файл)
+    int iterPos;           // Позиция для итератора (или -1)
+    T pinned;              // Буфер для getView/nextView (ёмкость переиспользуется)
+    T scratch;             // Буфер для внутренних чтений (поиск, индексы)
+
+    HashIndexFile hidx;    // хеш-индекс fname.hidx (если включён)
+    bool hidxOn;
+    BloomFilter bloom;     // фильтр Блума fname.bloom (если включён)
+    bool bloomOn;
+
+    // Асинхронный ввод-вывод (если включён): пакетное чтение данных
+    // узлов и упреждающее чтение итератора
+    IoEngine io;
+    bool asyncOn;
+    std::deque<T> ahead;       // прочитанные наперёд значения итератора
+    std::deque<int> aheadPos;  // их позиции в файле
+
+    std::shared_ptr<SnapshotHub<T>> snaps;  // закреплённые снимки
+
+    // Позиционный индекс: позиции узлов в порядке списка. Строится
+    // по требованию одним проходом и дальше поддерживается операциями,
+    // чтобы nodeAt() и бинарный поиск обходились без прохода по ссылкам.
+    std::deque<int> posIndex;
+    bool posValid;
+
+    size_t sortMemLimit;  // сколько байт данных sort() может держать в памяти
+
+    std::shared_ptr<WaitChannel> waitCh;  // общий для всех списков на этом файле
+
+public:
+    typedef typename NodeCodec<T>::View View;
+
+    // Конструктор/деструктор
+    BinaryList(const std::string& filename);
+    ~BinaryList();
+
+    // Основные операции
+    void push_back(const T& value);
+    void insert(int index, const T& value);
+    void erase(int index);
+    T    get(int index);
+    void update(int index, const T& value);
+    void pop_back();
+    void pop_front();
+    void clear();
+    void print();
+    int  getSize() const;
+    // Перечитать заголовок: файл мог изменить другой процесс
+    // (вызывается под межпроцессной блокировкой, см. FileLock)
+    void refresh();
+
+    // Выравнивание слотов узлов (хранится в заголовке):
+    //   0       — узлы вплотную друг к другу;
+    //   8, 64   — узел начинается на границе (узел до 64 байт
+    //             не пересекает кэш-линию);
+    //   4096    — блочная раскладка: узел не пересекает границу
+    //             страницы, get() затрагивает одну страницу.
+    // Существующие узлы переписываются по новой политике.
+    bool setAlignment(int bytes);
+    int  getAlignment() const;
+
+    // Анализ раскладки: один потоковый проход по ссылкам (данные
+    // строк не читаются, только длины). compact() переписывает
+    // живые узлы подряд в порядке списка и убирает мёртвые байты
+    // (кроме списков в контейнере: там он ничего не делает).
+    LayoutReport analyze();
+    void compact();
+
+    // Контрольные суммы CRC32C (флаг в заголовке): у каждого узла
+    // 4 байта CRC за данными, у заголовка — поле crc. Ссылки CRC не
+    // покрывает — их проверяет verify() по структуре. verify() ничего
+    // не меняет; rebuild() собирает список из уцелевших узлов
+    // (от head вперёд и от tail назад) и возвращает их число.
+    void enableChecksums();
+    void disableChecksums();
+    bool hasChecksums() const;
+    VerifyReport verify();
+    int  rebuild();
+
+    // Слоты строк по классам размера (флаг в заголовке): узел строки
+    // занимает слот ёмкости slabCap своего класса, слоты удалённых и
+    // перемещённых (update) строк уходят в slabHead и достаются новым
+    // строкам того же класса — файл не растёт без compact(). Пока
+    // открыты снимки, слоты не занимаются. Для T фиксированного
+    // размера не действует: у них свой список свободных.
+    void enableSlabs();
+    void disableSlabs();
+    bool hasSlabs() const;
+
+    // Импорт дописывает записи файла в конец списка одним проходом
+    // appendBulk (файл читается блоками по 1 МБ); экспорт пишет
+    // список по порядку блоками. Возвращают число записей или -1.
+    long long importFile(const std::string& path, DataFormat fmt);
+    long long exportFile(const std::string& path, DataFormat fmt);
+
+    // Диапазонные операции: одна правка связей на каждой границе
+    // и одна запись заголовка на весь диапазон
+    void erase(int first, int last);             // удалить [first, last)
+    int  pop_front_n(int n, T* out = nullptr);   // снять до n голов (в out), вернуть сколько
+    void truncate(int n);                        // оставить первые n элементов
+    // Если данные списка помещаются в лимит памяти, список читается
+    // целиком (строки — в арену), сортируется parallelSort на всех
+    // ядрах и переписывается одним проходом. Иначе фиксированный
+    // размер сортируется пузырьком прямо в файле, строки — в памяти.
+    void sort();
+    void setSortMemoryLimit(size_t bytes);  // 0 — только сортировка в файле
+
+    // Удаление за один проход по цепочке: ссылки правятся только на
+    // границах удалённых участков, заголовок пишется один раз.
+    // Слоты узлов фиксированного размера уходят в список свободных
+    // (FileHeader::freeHead) и занимаются новыми узлами раньше конца
+    // файла. Возвращают число удалённых элементов.
+    int unique();                                 // соседние равные (после sort — все повторы)
+    template <class Eq> int unique(Eq eq);
+    int remove(const T& value);
+    template <class Pred> int remove_if(Pred pred);
+
+    // Объединение списков (other после операции пуст)
+    void splice(BinaryList<T>& other);  // перенести other в конец
+    void merge(BinaryList<T>& other);   // слить два отсортированных списка
+
+    // Итератор
+    void initIterator();
+    bool hasNext();
+    T    next();
+    bool next(T& out);  // в готовый объект: строка переиспользует свою ёмкость
+
+    // Чтение без копирования: const T& (или string_view для строк)
+    // на внутренний буфер списка. Вид действителен до следующего
+    // вызова getView/nextView; после прогрева буфера чтение
+    // не выделяет память.
+    View getView(int index);
+    View nextView();
+
+    // Параллельные обходы: список делится на диапазоны, каждый
+    // диапазон читает свой поток пула через отдельный дескриптор.
+    // f/pred/op вызываются из разных потоков одновременно, порядок
+    // элементов между диапазонами не определён.
+    template <class F> void for_each(F f);
+    template <class Pred> int count_if(Pred pred);
+    template <class Op> T reduce(T init, Op op);
+    template <class R, class ReduceOp, class Map>
+    R transform_reduce(R init, ReduceOp reduceOp, Map map);
+
+    // Проекция поля (только типы фиксированного размера, поле —
+    // скаляр): из узла копируется sizeof(M) байт по смещению поля,
+    // запись целиком не декодируется. count_if/find_all с полем —
+    // параллельные фильтры; sort_by устойчиво сортирует по полю,
+    // держа в памяти только пары (поле, позиция), и переписывает
+    // одни ссылки — данные узлов остаются на месте.
+    // (C — тот же T: у int нет членов, поэтому класс выводится из аргумента)
+    template <class M, class C> M    read_field(int index, M C::*field);
+    template <class M, class C> void read_field(M C::*field, std::vector<M>& out);  // все, по порядку
+    template <class M, class C, class Pred> int count_if(M C::*field, Pred pred);
+    template <class M, class C, class Pred> std::vector<int> find_all(M C::*field, Pred pred);  // индексы
+    template <class M, class C> void sort_by(M C::*field);
+
+    // Отсортированный режим (флаг HF_SORTED в заголовке). Поиск —
+    // бинарный, через позиционный индекс: O(log n) чтений узлов.
+    // Запросы файл не меняют: у неотсортированного списка
+    // lower_bound/upper_bound возвращают -1, insert_sorted ничего не
+    // вставляет, find ищет линейно — порядок наводит только sort().
+    bool isSorted() const;
+    void insert_sorted(const T& value);  // после равных (FIFO среди равных)
+    int  lower_bound(const T& value);    // первый индекс с элементом >= value
+    int  upper_bound(const T& value);    // первый индекс с элементом > value
+    int  find(const T& value);           // индекс элемента или -1
+    bool pop_front(T& out);              // снять голову (минимум, если отсортирован)
+
+    // Ожидание непустого списка без опроса: засыпает до записи в
+    // файл из этого процесса (любым BinaryList на том же имени файла)
+    // или из другого (inotify). Проверка и снятие головы идут под
+    // FileLock(fname + ".lock"), поэтому писатели с других объектов
+    // и из других процессов пишут так же: lock, refresh, запись,
+    // flush, unlock (как LoadQueue). Блокировку на время ожидания
+    // не держать — её берёт сам pop_front_wait.
+    // timeoutMs < 0 — ждать без ограничения; false — истёк таймаут.
+    bool wait_nonempty(int timeoutMs = -1);
+    bool pop_front_wait(T& out, int timeoutMs = -1);
+    // Низкоуровневая пара для списка, общего для потоков под мьютексом:
+    // запомнить appendSeq() до проверки под мьютексом, ждать без него.
+    // waitChange не трогает состояние списка.
+    unsigned long long appendSeq() const;
+    bool waitChange(unsigned long long seen, int timeoutMs) const;
+
+    // Хеш-индекс «ключ -> позиция узла» в файле fname.hidx.
+    // Если файл индекса есть, он подхватывается при открытии списка
+    // и поддерживается всеми изменениями; устаревший перестраивается.
+    typedef typename KeyOf<T>::Key Key;
+    void enableHashIndex();
+    void disableHashIndex();              // удаляет файл индекса
+    bool find(const Key& key, T& out);    // O(1) чтений при включённом индексе
+    bool contains(const Key& key);
+
+    // Фильтр Блума по тем же ключам (fname.bloom): отрицательный ответ
+    // find/contains даётся в памяти, без чтения файла списка
+    void enableBloomFilter();
+    void disableBloomFilter();            // удаляет файл фильтра
+
+    // Асинхронный ввод-вывод через IoEngine: print, readAll и итератор
+    // читают данные узлов пакетами, а правки ссылок двух соседей
+    // в insert/erase/update уходят на диск одновременно.
+    void enableAsyncIO();
+    void disableAsyncIO();
+    // Чтение по набору индексов одним пакетом (позиции — из
+    // позиционного индекса); работает и без enableAsyncIO
+    void getMany(const std::vector<int>& indices, std::vector<T>& out);
+
+    // Снимок текущей версии списка (MVCC): читатель обходит её сколь
+    // угодно долго, а erase/update/sort продолжают работать — узлы,
+    // которые они переписывают на месте, сохраняются для снимка.
+    // Снимок должен жить не дольше списка.
+    std::unique_ptr<ListSnapshot<T>> snapshot();
+
+    // Резервная копия файла «на ходу»: под FileLock (писатели других
+    // процессов, работающие под ней, ждут только на время копирования)
+    // после flush файл клонируется (cloneFile) в path.tmp и
+    // переименовывается в path. open_clone — копия и отдельный список
+    // на ней: с reflink почти мгновенно даже для большого файла, а
+    // записи в копию оригинал не затрагивают.
+    bool snapshot_to(const std::string& path);
+    std::unique_ptr<BinaryList<T>> open_clone(const std::string& path);
+
+private:
+    friend class ListContainer;
+    // Список внутри файла-контейнера (создаёт ListContainer::open)
+    BinaryList(const std::string& file, const std::string& name, int headerPos,
+               std::shared_ptr<ContainerSpace> sp);
+    void attachSidecars();  // подхватить fname.hidx и fname.bloom, если они есть
+
+    // Вспомогательные функции чтения/записи заголовка
+    void readHeader();
+    void writeHeader();
+    void initHeader();
+    int  diskSize();  // size из заголовка на диске; fh не меняется
+    template <class Take> bool waitTake(int timeoutMs, Take take);  // wait_nonempty, pop_front_wait
+    void upgradeLegacy();
+
+    // Доступ к полям узла
+    int  readNext(int pos);
+    int  readPrev(int pos);
+    void writeNext(int pos, int next);
+    void writePrev(int pos, int prev);
+    void readValue(int pos, T& value);
+    int  appendNode(int prev, int next, const T& value);  // узел в конец файла
+    int  nodeAt(int index);                                // позиция узла по индексу
+    int  slotFor(int end, int len) const;                  // где встанет новый узел длины len
+    int  allocTail(int len);                               // место под узел в конце файла
+    int  contiguousPos(int index) const;                   // позиция узла при HF_CONTIGUOUS
+    int  crcBytes() const { return (fh.flags & HF_CHECKSUM) ? (int)sizeof(unsigned) : 0; }
+    int  nodeSpan(int payload) const;                      // место узла в файле (со слотом класса)
+    void releaseSlot(int pos);                             // слот удалённой строки — в slabHead
+    void sealPayload(char* data, int payload) const;       // CRC за данными (при HF_CHECKSUM)
+    bool payloadOk(const char* data, int len) const;       // CRC данных узла длины len
+    void writePayload(int pos, const T& value);            // данные фиксированного размера на место
+    bool peekNode(FileWindow& win, int pos, bool seq, int* links, int& len,
+                  const char*& data) const;
+    void adoptLayout(BinaryList<T>& out) const;            // выравнивание и CRC — в пустой out
+    bool sameList(const BinaryList<T>& other) const;       // тот же файл и тот же заголовок
+    template <class Change> void relayout(Change change);  // переписать узлы после смены раскладки
+    void buildPosIndex();
+    void ensurePosIndex();                                 // для бинарного поиска
+    void insertNode(int index, const T& value, bool ordered);  // ordered: HF_SORTED не сбрасывать
+
+    // Поддержка хеш-индекса
+    void attachHashIndex();
+    void rebuildHashIndex();
+    void idxAdd(const T& value, int pos);
+    void idxRemoveAt(int pos);
+    int  eraseRange(int first, int last, T* out);
+    void rebuildBloom();
+
+    bool ioReady();
+    bool readPayloads(const std::vector<int>& pos, T* out);
+    void patchLinks(int p, int pNext, int n, int nPrev);  // p->next, n->prev
+    template <class Visit> void scanAhead(Visit visit);
+    void fillAhead();
+    void dropReadAhead();
+
+    // Любая запись поверх существующих байт файла идёт после beforeWrite
+    void beforeWrite(int pos, int len);
+    void detachSnapshots();
+
+    // Перезапись файла целиком: узлы подряд, в порядке vec
+    void resetFile();
+    void rewriteAll(const std::vector<T>& vec);
+    void readAll(std::vector<T>& vec);
+    // Только для строк: весь список в арену и обратно (в порядке order)
+    void readAll(StringArena& arena);
+    void rewriteAll(const StringArena& arena, const std::vector<int>& order);
+    template <class Src> void appendBulk(Src src);
+    template <class Visit> void scanParallel(Visit visit);
+    template <class Visit> void scanNodesParallel(Visit visit);
+    template <class Visit> void scanBlocks(Visit visit);
+    template <class M, class C> static int fieldOffset(M C::*field);
+    void relink(const std::vector<int>& order);  // связать узлы в порядке позиций order
+    struct LinkPatch { int pos; int links[2]; };  // новые [prev][next] узла pos
+    void writePatches(std::vector<LinkPatch>& patches);
+    template <class Drop> int removeWhere(Drop drop);
+    void replaceFile(const std::string& tmpName);
+};
+
+//-----------------------------------------------------
+// Реализация шаблона BinaryList<T>
+//-----------------------------------------------------
+template <class T>
+BinaryList<T>::BinaryList(const std::string& filename)
+    : std::fstream(), fname(filename), path(filename), base(0), iterPos(-1),
+      hidxOn(false), bloomOn(false), asyncOn(false),
+      snaps(std::make_shared<SnapshotHub<T>>()), posValid(false),
+      sortMemLimit(256u << 20), waitCh(WaitChannel::forFile(filename))
+{
+    // Открываем бинарный файл (без trunc), чтобы сохранялся между запусками
+    open(path.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    if (!is_open()) {
+        // Если файла нет, создаём
+        std::ofstream ff(path.c_str(), std::ios::binary);
+        ff.close();
+        // И снова открываем на чтение+запись
+        open(path.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    }
+
+    if (is_open()) {
+        // Проверяем размер файла
+        seekg(0, std::ios::end);
+        std::streamoff sz = tellg();
+        if (sz < (std::streamoff)(3 * sizeof(int))) {
+            // Инициализируем заголовок пустого списка
+            initHeader();
+            writeHeader();
+        }
+        else {
+            readHeader();
+            if (sz < (std::streamoff)sizeof(FileHeader) || fh.magic != HEADER_MAGIC) {
+                // Файл старого формата (12-байтный заголовок) — переводим в текущий
+                upgradeLegacy();
+            }
+        }
+    }
+    else {
+        // На случай, если открыть не удалось вообще
+        initHeader();
+    }
+    attachSidecars();
+}
+
+// Файл контейнера уже существует; новая запись каталога обнулена
+// (magic = 0) — тогда список начинается с пустого заголовка
+template <class T>
+BinaryList<T>::BinaryList(const std::string& file, const std::string& name, int headerPos,
+                          std::shared_ptr<ContainerSpace> sp)
+    : std::fstream(), fname(file + "#" + name), path(file), base(headerPos), space(sp), iterPos(-1),
+      hidxOn(false), bloomOn(false), asyncOn(false),
+      snaps(std::make_shared<SnapshotHub<T>>()), posValid(false),
+      sortMemLimit(256u << 20), waitCh(WaitChannel::forFile(file))
+{
+    open(path.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    if (is_open()) {
+        readHeader();
+    }
+    if (!is_open() || fh.magic != HEADER_MAGIC) {
+        initHeader();
+        if (is_open()) writeHeader();
+    }
+    attachSidecars();
+}
+
+// Спутники: хеш-индекс и фильтр Блума подхватываем, если они уже созданы
+template <class T>
+void BinaryList<T>::attachSidecars() {
+    if (is_open()) {
+        std::ifstream probe((fname + ".hidx").c_str(), std::ios::binary);
+        if (probe.is_open()) {
+            probe.close();
+            attachHashIndex();
+        }
+        probe.open((fname + ".bloom").c_str(), std::ios::binary);
+        if (probe.is_open()) {
+            probe.close();
+            enableBloomFilter();
+        }
+    }
+}
+
+template <class T>
+BinaryList<T>::~BinaryList() {
+    if (hidxOn) {
+        hidx.detach(fh.gen);
+    }
+    if (bloomOn) {
+        bloom.save(fname + ".bloom", fh.gen);
+    }
+    if (is_open()) {
+        close();
+    }
+}
+
+template <class T>
+void BinaryList<T>::readHeader() {
+    seekg(base, std::ios::beg);
+    read(reinterpret_cast<char*>(&fh), sizeof(FileHeader));
+    if (!good()) {
+        std::fstream::clear();  // короткий файл старого формата
+        return;
+    }
+    if ((fh.flags & HF_CHECKSUM) && fh.crc != headerCrc(fh)) {
+        std::cout << "[" << Codec::tag() << "] Контрольная сумма заголовка " << fname
+                  << " не совпадает (проверка: verify)" << std::endl;
+    }
+}
+
+template <class T>
+void BinaryList<T>::writeHeader() {
+    dropReadAhead();  // прочитанное наперёд могло устареть
+    fh.gen++;  // по нему файлы-спутники (индексы) узнают, что устарели
+    fh.crc = (fh.flags & HF_CHECKSUM) ? headerCrc(fh) : 0;
+    seekp(base, std::ios::beg);
+    write(reinterpret_cast<const char*>(&fh), sizeof(FileHeader));
+    if (waitCh.use_count() > 1) {
+        flush();  // другие списки этого процесса на том же файле читают его сами
+    }
+    waitCh->notify();
+}
+
+template <class T>
+int BinaryList<T>::diskSize() {
+    flush();
+    int size;
+    seekg(base + (int)offsetof(FileHeader, size), std::ios::beg);
+    read(reinterpret_cast<char*>(&size), sizeof(int));
+    if (!good()) {
+        std::fstream::clear();
+        return fh.size;
+    }
+    return size;
+}
+
+// Пустой список текущего формата
+template <class T>
+void BinaryList<T>::initHeader() {
+    std::memset(&fh, 0, sizeof(FileHeader));
+    fh.head = -1;
+    fh.tail = -1;
+    fh.size = 0;
+    fh.magic = HEADER_MAGIC;
+    fh.version = HEADER_VERSION;
+    // пустой список тривиально «подряд» (для узлов фиксированного размера);
+    // HF_SORTED ставят только sort, merge и insert_sorted — иначе
+    // каждый push_back очереди перечитывал бы tail ради флага
+    fh.flags = Codec::fixedSize ? HF_CONTIGUOUS : 0;
+    posIndex.clear();
+    posValid = true;
+}
+
+// Версия 1: заголовок [head][tail][size], узлы того же вида.
+// Вычитываем цепочку и переписываем файл в текущем формате.
+template <class T>
+void BinaryList<T>::upgradeLegacy() {
+    std::vector<T> vec;
+    vec.reserve(fh.size > 0 ? fh.size : 0);
+    int cur = fh.head;
+    for (int i = 0; i < fh.size && cur != -1; i++) {
+        T val{};
+        int n = readNext(cur);
+        readValue(cur, val);
+        vec.push_back(val);
+        cur = n;
+    }
+    std::cout << "[" << Codec::tag() << "] Файл " << fname
+              << " старого формата, преобразован (" << vec.size() << " эл.)\n";
+    rewriteAll(vec);
+}
+
+//-----------------------------------------------------
+// Доступ к полям узла
+//-----------------------------------------------------
+template <class T>
+int BinaryList<T>::readNext(int pos) {
+    int n;
+    seekg(pos + sizeof(int), std::ios::beg);  // pos + 4 => поле next
+    read(reinterpret_cast<char*>(&n), sizeof(int));
+    return n;
+}
+
+template <class T>
+int BinaryList<T>::readPrev(int pos) {
+    int p;
+    seekg(pos, std::ios::beg);
+    read(reinterpret_cast<char*>(&p), sizeof(int));
+    return p;
+}
+
+template <class T>
+void BinaryList<T>::writeNext(int pos, int next) {
+    beforeWrite(pos + sizeof(int), sizeof(int));
+    seekp(pos + sizeof(int), std::ios::beg);
+    write(reinterpret_cast<const char*>(&next), sizeof(int));
+}
+
+template <class T>
+void BinaryList<T>::writePrev(int pos, int prev) {
+    beforeWrite(pos, sizeof(int));
+    seekp(pos, std::ios::beg);
+    write(reinterpret_cast<const char*>(&prev), sizeof(int));
+}
+
+template <class T>
+void BinaryList<T>::readValue(int pos, T& value) {
+    seekg(pos + LINKS, std::ios::beg);
+    Codec::read(*this, value);
+}
+
+// Узел собирается в буфере и пишется в конец файла одним блоком
+template <class T>
+int BinaryList<T>::appendNode(int prev, int next, const T& value) {
+    int payload = Codec::encodedSize(value);
+    int len = LINKS + payload + crcBytes();
+    int span = nodeSpan(payload);  // для строк в слотах — с хвостом слота
+    int cls = slabClass(payload - (int)sizeof(int));
+    int newPos;
+    if (Codec::fixedSize && fh.freeCount > 0) {
+        // Слот узла, удалённого remove_if/unique: того же размера
+        // и на границе выравнивания
+        newPos = fh.freeHead;
+        fh.freeHead = readNext(newPos);
+        fh.freeCount--;
+        beforeWrite(newPos, (int)sizeof(int));  // по полям, как writePrev/writeNext/writePayload
+        beforeWrite(newPos + (int)sizeof(int), (int)sizeof(int));
+        beforeWrite(newPos + LINKS, len - LINKS);
+        seekp(newPos, std::ios::beg);
+    }
+    else if (!Codec::fixedSize && (fh.flags & HF_SLABS) && fh.slabHead[cls] > 0
+             && snaps->count.load() == 0) {
+        // Свободный слот того же класса. Пока открыты снимки, слоты
+        // строк не занимаются: снимок читает данные строк с диска как есть
+        newPos = fh.slabHead[cls];
+        fh.slabHead[cls] = readNext(newPos);
+        fh.freeCount--;
+        span = len;  // хвост слота уже есть в файле
+        seekp(newPos, std::ios::beg);
+    }
+    else {
+        newPos = allocTail(span);
+        seekp(newPos, std::ios::beg);  // с пропуском до границы слота
+    }
+
+    char fixedBuf[NODE_SIZE > 0 ? NODE_SIZE + sizeof(unsigned) : 1];
+    std::vector<char> varBuf;
+    char* buf = fixedBuf;
+    if (!Codec::fixedSize) {
+        varBuf.resize(span);
+        buf = varBuf.data();
+    }
+    std::memcpy(buf, &prev, sizeof(int));
+    std::memcpy(buf + sizeof(int), &next, sizeof(int));
+    Codec::encode(value, buf + LINKS);
+    sealPayload(buf + LINKS, payload);
+    write(buf, span);
+    return newPos;
+}
+
+template <class T>
+int BinaryList<T>::nodeSpan(int payload) const {
+    if (!Codec::fixedSize && (fh.flags & HF_SLABS)) {
+        payload = (int)sizeof(int) + slabCap(slabClass(payload - (int)sizeof(int)));
+    }
+    return LINKS + payload + crcBytes();
+}
+
+// Узел уже отцеплен: его слот становится головой списка свободных
+// своего класса (prev = -2), заголовок пишет вызывающий
+template <class T>
+void BinaryList<T>::releaseSlot(int pos) {
+    if (Codec::fixedSize || !(fh.flags & HF_SLABS)) return;
+    int len;
+    seekg(pos + LINKS, std::ios::beg);
+    read(reinterpret_cast<char*>(&len), sizeof(int));
+    int c = slabClass(len);
+    int links[2] = { -2, fh.slabHead[c] };
+    beforeWrite(pos, (int)sizeof(int));
+    beforeWrite(pos + (int)sizeof(int), (int)sizeof(int));
+    seekp(pos, std::ios::beg);
+    write(reinterpret_cast<const char*>(links), LINKS);
+    fh.slabHead[c] = pos;
+    fh.freeCount++;
+}
+
+template <class T>
+void BinaryList<T>::sealPayload(char* data, int payload) const {
+    if (fh.flags & HF_CHECKSUM) {
+        unsigned c = crc32c(data, payload);
+        std::memcpy(data + payload, &c, sizeof(c));
+    }
+}
+
+template <class T>
+bool BinaryList<T>::payloadOk(const char* data, int len) const {
+    if (!(fh.flags & HF_CHECKSUM)) return true;
+    int payload = len - LINKS - (int)sizeof(unsigned);
+    unsigned stored;
+    std::memcpy(&stored, data + payload, sizeof(stored));
+    return crc32c(data, payload) == stored;
+}
+
+template <class T>
+void BinaryList<T>::writePayload(int pos, const T& value) {
+    char buf[NODE_SIZE > 0 ? Codec::size + sizeof(unsigned) : 1];
+    Codec::encode(value, buf);
+    sealPayload(buf, Codec::size);
+    int len = Codec::size + crcBytes();
+    beforeWrite(pos + LINKS, len);
+    seekp(pos + LINKS, std::ios::beg);
+    write(buf, len);
+}
+
+// Слот для узла длины len при конце файла end (см. FileHeader::align)
+template <class T>
+int BinaryList<T>::slotFor(int end, int len) const {
+    int a = fh.align;
+    if (a <= 1) return end;
+    if (a <= 64) return (end + a - 1) / a * a;
+    // Блочная раскладка: выравнивание по 8, а узел, не влезший
+    // в остаток блока, начинается со следующего блока
+    int p = (end + 7) / 8 * 8;
+    if (len <= a && p / a != (p + len - 1) / a) {
+        p = (p / a + 1) * a;
+    }
+    return p;
+}
+
+// Слот нового узла за концом файла; у списка в контейнере конец
+// общий и сдвигается сразу, под мьютексом ContainerSpace
+template <class T>
+int BinaryList<T>::allocTail(int len) {
+    if (space) {
+        std::lock_guard<std::mutex> lk(space->m);
+        int pos = slotFor(space->end, len);
+        space->end = pos + len;
+        return pos;
+    }
+    seekp(0, std::ios::end);
+    return slotFor((int)tellp(), len);
+}
+
+// Узлы фиксированного размера, записанные подряд по slotFor:
+// шаг — размер слота, а в блочной раскладке — по k слотов на блок
+// (первый блок начинается с head и может быть неполным)
+template <class T>
+int BinaryList<T>::contiguousPos(int index) const {
+    int a = fh.align;
+    int ns = NODE_SIZE + crcBytes();
+    if (a <= 1) return fh.head + index * ns;
+    if (a <= 64) return fh.head + index * ((ns + a - 1) / a * a);
+    int slot = (ns + 7) / 8 * 8;
+    if (slot > a) return fh.head + index * slot;
+    int k = a / slot;
+    int o = fh.head % a;
+    int f = (a - o) / slot;  // слотов в первом блоке
+    if (index < f) return fh.head + index * slot;
+    int j = index - f;
+    return (fh.head - o) + a * (1 + j / k) + (j % k) * slot;
+}
+
+// Позиция узла с номером index. Если узлы лежат подряд —
+// одна формула, есть позиционный индекс — берём из него,
+// иначе идём по ссылкам от ближайшего конца.
+template <class T>
+int BinaryList<T>::nodeAt(int index) {
+    if (Codec::fixedSize && (fh.flags & HF_CONTIGUOUS)) {
+        return contiguousPos(index);
+    }
+    if (posValid) {
+        return posIndex[index];
+    }
+    if (index <= fh.size / 2) {
+        int cur = fh.head;
+        for (int i = 0; i < index; i++) {
+            cur = readNext(cur);
+        }
+        return cur;
+    }
+    int cur = fh.tail;
+    for (int i = fh.size - 1; i > index; i--) {
+        cur = readPrev(cur);
+    }
+    return cur;
+}
+
+// Добавить элемент в конец (push_back)
+template <class T>
+void BinaryList<T>::push_back(const T& value) {
+    if (!is_open()) return; // Если файл не открыт, выходим.
+
+    // Порядок сохраняется, если новое значение не меньше хвоста
+    // (tail читается только у списка с флагом HF_SORTED)
+    if ((fh.flags & HF_SORTED) && fh.size > 0) {
+        readValue(fh.tail, scratch);
+        if (value < scratch) {
+            fh.flags &= ~HF_SORTED;
+        }
+    }
+
+    // Записываем сам узел: prev — текущий tail, следующего нет
+    int newPos = appendNode(fh.tail, -1, value);
+    if (posValid) {
+        posIndex.push_back(newPos);
+    }
+    idxAdd(value, newPos);
+
+    if (fh.size == 0) {
+        // Если список был пуст
+        fh.head = newPos;
+        fh.tail = newPos;
+        fh.size = 1;
+    }
+    else {
+        // Обновляем next у бывшего tail
+        writeNext(fh.tail, newPos);
+        // Узел лёг в следующий слот за tail — список по-прежнему «подряд»
+        int ns = NODE_SIZE + crcBytes();
+        if (slotFor(fh.tail + ns, ns) != newPos) {
+            fh.flags &= ~HF_CONTIGUOUS;
+        }
+        fh.tail = newPos;
+        fh.size++;
+    }
+    writeHeader();
+}
+
+// Вставка по индексу (insert)
+template <class T>
+void BinaryList<T>::insert(int index, const T& value) {
+    insertNode(index, value, false);
+}
+
+template <class T>
+void BinaryList<T>::insertNode(int index, const T& value, bool ordered) {
+    if (!is_open()) return;
+    // Место из insert_sorted порядок не нарушает
+    int drop = ordered ? HF_CONTIGUOUS : (HF_CONTIGUOUS | HF_SORTED);
+    if (index < 0 || index > fh.size) {
+        std::cout << "[" << Codec::tag() << "] Неверный индекс insert: " << index << "\n";
+        return;
+    }
+    // Если вставка в конец, то это просто push_back
+    if (index == fh.size) {
+        push_back(value);
+        return;
+    }
+    // Если вставка в начало
+    if (index == 0) {
+        // Создаём новый узел в конце файла
+        int newPos = appendNode(-1, fh.head, value);
+        idxAdd(value, newPos);
+
+        // Старому head проставляем prev = newPos
+        writePrev(fh.head, newPos);
+        fh.head = newPos; // Новый head — это новый узел.
+        fh.size++;
+        fh.flags &= ~drop;
+        if (posValid) {
+            posIndex.push_front(newPos);
+        }
+        writeHeader(); // Обновляем заголовок.
+        return;
+    }
+
+    // Иначе вставка «в середину»
+    // currentPos — это позиция узла, который будет стоять после вставляемого
+    int currentPos = nodeAt(index);
+    int oldPrev = readPrev(currentPos);
+
+    // Создаём новый узел (записываем в конец файла)
+    int newPos = appendNode(oldPrev, currentPos, value);
+    idxAdd(value, newPos);
+
+    // Теперь у узла currentPos поле prev = newPos,
+    // а у старого prev (он есть, т.к. index > 0) поле next = newPos
+    patchLinks(oldPrev, newPos, currentPos, newPos);
+
+    fh.size++;
+    fh.flags &= ~drop;
+    if (posValid) {
+        posIndex.insert(posIndex.begin() + index, newPos);
+    }
+    writeHeader();
+}
+
+// Удаление по индексу (erase)
+template <class T>
+void BinaryList<T>::erase(int index) {
+    if (!is_open()) return;
+    if (index < 0 || index >= fh.size) {
+        std::cout << "[" << Codec::tag() << "] Неверный индекс erase: " << index << "\n";
+        return;
+    }
+
+    // Ищем узел и считываем его prev, next
+    int currentPos = nodeAt(index);
+    int p = readPrev(currentPos);
+    int n = readNext(currentPos);
+    idxRemoveAt(currentPos);
+
+    // Удаление с концов не разрывает «подряд» лежащие узлы
+    if (index != 0 && index != fh.size - 1) {
+        fh.flags &= ~HF_CONTIGUOUS;
+    }
+    // Если удаляемый узел — это head
+    if (currentPos == fh.head) {
+        fh.head = n;
+    }
+    // Если удаляемый узел — это tail
+    if (currentPos == fh.tail) {
+        fh.tail = p;
+    }
+    // p->next = n, n->prev = p
+    patchLinks(p, n, n, p);
+    releaseSlot(currentPos);
+
+    fh.size--;
+    if (fh.size == 0 && Codec::fixedSize) {
+        fh.flags |= HF_CONTIGUOUS;
+    }
+    if (posValid) {
+        posIndex.erase(posIndex.begin() + index);
+    }
+    writeHeader();
+}
+
+// Получить элемент по индексу (get)
+template <class T>
+T BinaryList<T>::get(int index) {
+    T result{};
+    if (!is_open()) return result;
+    if (index < 0 || index >= fh.size) {
+        std::cout << "[" << Codec::tag() << "] Неверный индекс get: " << index << "\n";
+        return result;
+    }
+    readValue(nodeAt(index), result);
+    return result;
+}
+
+// Обновить элемент по индексу (update)
+template <class T>
+void BinaryList<T>::update(int index, const T& value) {
+    if (!is_open()) return;
+    if (index < 0 || index >= fh.size) {
+        std::cout << "[" << Codec::tag() << "] Неверный индекс update: " << index << "\n";
+        return;
+    }
+    int cur = nodeAt(index);
+    fh.flags &= ~HF_SORTED;
+    idxRemoveAt(cur);
+    if constexpr (Codec::fixedSize) {
+        // Размер не меняется — пишем данные на место
+        writePayload(cur, value);
+        idxAdd(value, cur);
+        writeHeader();
+    }
+    else {
+        // Новое значение может не влезть на старое место, поэтому
+        // пишем новый узел в конец файла и перевешиваем на него соседей
+        // (старый узел становится «мёртвым» или, с HF_SLABS, свободным слотом).
+        int p = readPrev(cur);
+        int n = readNext(cur);
+        int newPos = appendNode(p, n, value);
+        idxAdd(value, newPos);
+        patchLinks(p, newPos, n, newPos);
+        releaseSlot(cur);
+        if (p == -1) fh.head = newPos;
+        if (n == -1) fh.tail = newPos;
+        if (posValid) {
+            posIndex[index] = newPos;
+        }
+        writeHeader();
+    }
+}
+
+// Удалить последний элемент (pop_back)
+template <class T>
+void BinaryList<T>::pop_back() {
+    if (fh.size == 0) {
+        std::cout << "[" << Codec::tag() << "] Список пуст (pop_back)\n";
+        return;
+    }
+    erase(fh.size - 1);
+}
+
+// Дополнительно: удалить первый элемент (pop_front)
+// (если хотим логику очереди, где удаление идёт с "головы")
+template <class T>
+void BinaryList<T>::pop_front() {
+    if (fh.size == 0) {
+        std::cout << "[" << Codec::tag() << "] Список пуст (pop_front)\n";
+        return;
+    }
+    erase(0);
+}
+
+//-----------------------------------------------------
+// Диапазонные операции
+//-----------------------------------------------------
+template <class T>
+void BinaryList<T>::erase(int first, int last) {
+    if (!is_open()) return;
+    if (first < 0 || first > last || last > fh.size) {
+        std::cout << "[" << Codec::tag() << "] Неверный диапазон erase: ["
+                  << first << ", " << last << ")\n";
+        return;
+    }
+    if (first == last) return;
+    eraseRange(first, last, nullptr);
+}
+
+// Пустой список — не ошибка: потребитель просто получает 0
+template <class T>
+int BinaryList<T>::pop_front_n(int n, T* out) {
+    if (!is_open() || n <= 0 || fh.size == 0) return 0;
+    if (n > fh.size) n = fh.size;
+    return eraseRange(0, n, out);
+}
+
+template <class T>
+void BinaryList<T>::truncate(int n) {
+    if (!is_open()) return;
+    if (n < 0) {
+        std::cout << "[" << Codec::tag() << "] Неверный размер truncate: " << n << "\n";
+        return;
+    }
+    if (n >= fh.size) return;
+    eraseRange(n, fh.size, nullptr);
+}
+
+// Вырезаем [first, last) целиком: соседи диапазона связываются
+// напрямую, узлы внутри становятся «мёртвыми». Диапазон проходим
+// подряд только если нужны значения (out или хеш-индекс) или слоты
+// строк уходят в slabHead, иначе правая граница берётся через nodeAt.
+template <class T>
+int BinaryList<T>::eraseRange(int first, int last, T* out) {
+    int cnt = last - first;
+    int firstPos = nodeAt(first);
+    int p = readPrev(firstPos);
+    int n;
+    bool slabs = !Codec::fixedSize && (fh.flags & HF_SLABS);
+    if (out || hidxOn || slabs) {
+        n = firstPos;
+        for (int i = 0; i < cnt; i++) {
+            int nx = readNext(n);
+            T& v = out ? out[i] : scratch;
+            Codec::read(*this, v);
+            if (hidxOn) {
+                hidx.remove(KeyOf<T>::hash(KeyOf<T>::key(v)), n);
+            }
+            releaseSlot(n);
+            n = nx;
+        }
+    }
+    else {
+        n = last < fh.size ? nodeAt(last) : -1;
+    }
+    if (bloomOn) {
+        bloom.noteRemoved(cnt);
+    }
+
+    // Срез с любого конца не разрывает «подряд» лежащие узлы
+    if (first != 0 && last != fh.size) {
+        fh.flags &= ~HF_CONTIGUOUS;
+    }
+    patchLinks(p, n, n, p);
+    if (p == -1) fh.head = n;
+    if (n == -1) fh.tail = p;
+
+    fh.size -= cnt;
+    if (fh.size == 0 && Codec::fixedSize) {
+        fh.flags |= HF_CONTIGUOUS;
+    }
+    if (posValid) {
+        posIndex.erase(posIndex.begin() + first, posIndex.begin() + last);
+    }
+    writeHeader();
+    return cnt;
+}
+
+// Удалить файл и создать его заново с пустым заголовком
+template <class T>
+void BinaryList<T>::resetFile() {
+    detachSnapshots();
+    // Файл контейнера общий: узлы списка просто становятся мёртвым местом
+    if (!space) {
+        io.close();  // файл пересоздаётся — старый дескриптор не годится
+        if (is_open()) {
+            close();
+        }
+        std::remove(path.c_str()); // удаляем файл
+        // Создаём заново
+        {
+            std::ofstream ff(path.c_str(), std::ios::binary);
+            ff.close();
+        }
+        open(path.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    }
+
+    // Пустой заголовок; выравнивание, контрольные суммы и слоты строк сохраняются
+    int align = fh.align;
+    int keepFlags = fh.flags & (HF_CHECKSUM | HF_SLABS);
+    initHeader();
+    fh.align = align;
+    fh.flags |= keepFlags;
+    writeHeader();
+    if (hidxOn) {
+        hidx.rebuild(std::vector<HashSlot>());
+    }
+    if (bloomOn) {
+        bloom.reset(0);
+    }
+}
+
+// Очистить весь список (clear)
+template <class T>
+void BinaryList<T>::clear() {
+    resetFile();
+    iterPos = -1;
+}
+
+// Дописать узлы подряд в конец файла и прицепить их после tail.
+// src(T&) выдаёт очередное значение и возвращает false в конце.
+// Позиции соседей известны заранее, поэтому узлы пишутся блоками
+// через один буфер, без возвратов к уже записанным узлам; ссылка
+// старого tail и заголовок обновляются по одному разу.
+template <class T>
+template <class Src>
+void BinaryList<T>::appendBulk(Src src) {
+    if (!is_open()) return;
+    const size_t CHUNK = 1 << 20;  // сбрасываем буфер примерно по 1 МБ
+    std::vector<char> buf;
+
+    T cur{}, nxt{};
+    bool have = src(cur);
+    // В контейнере общий конец занят на всю запись: узлы идут подряд
+    std::unique_lock<std::mutex> lk;
+    int end;
+    if (space) {
+        lk = std::unique_lock<std::mutex>(space->m);
+        end = space->end;
+    }
+    else {
+        seekp(0, std::ios::end);
+        end = (int)tellp();
+    }
+    int first = have ? slotFor(end, nodeSpan(Codec::encodedSize(cur))) : end;
+    seekp(first, std::ios::beg);
+    int pos = first;
+    int stop = first;
+    int prev = fh.tail;
+    int count = 0;
+    while (have) {
+        bool more = src(nxt);
+        int payload = Codec::encodedSize(cur);
+        int len = nodeSpan(payload);  // хвост слота (HF_SLABS) — нулями
+        int next = more ? slotFor(pos + len, nodeSpan(Codec::encodedSize(nxt))) : -1;
+
+        size_t at = buf.size();
+        buf.resize(at + len, 0);
+        std::memcpy(&buf[at], &prev, sizeof(int));
+        std::memcpy(&buf[at + sizeof(int)], &next, sizeof(int));
+        Codec::encode(cur, &buf[at + LINKS]);
+        sealPayload(&buf[at + LINKS], payload);
+        if (more) {
+            buf.resize(buf.size() + (next - pos - len), 0);  // выравнивание до слота
+        }
+        if (buf.size() >= CHUNK) {
+            write(buf.data(), buf.size());
+            buf.clear();
+        }
+        if (posValid) {
+            posIndex.push_back(pos);
+        }
+        idxAdd(cur, pos);
+        stop = pos + len;
+        prev = pos;
+        pos = next;
+        count++;
+        std::swap(cur, nxt);
+        have = more;
+    }
+    if (count == 0) return;
+    write(buf.data(), buf.size());
+    if (space) {
+        space->end = stop;
+        lk.unlock();
+    }
+
+    if (fh.size == 0) {
+        fh.head = first;
+    }
+    else {
+        writeNext(fh.tail, first);
+        int ns = NODE_SIZE + crcBytes();
+        if (slotFor(fh.tail + ns, ns) != first) {
+            fh.flags &= ~HF_CONTIGUOUS;
+        }
+    }
+    fh.tail = prev;
+    fh.size += count;
+    fh.flags &= ~HF_SORTED;  // порядок источника неизвестен; sort/merge ставят флаг сами
+    writeHeader();
+}
+
+// Перезаписать файл из вектора: узлы идут подряд в порядке vec
+template <class T>
+void BinaryList<T>::rewriteAll(const std::vector<T>& vec) {
+    resetFile();
+    iterPos = -1;
+    size_t i = 0;
+    appendBulk([&](T& out) {
+        if (i == vec.size()) return false;
+        out = vec[i++];
+        return true;
+    });
+}
+
+// Заменить файл списка готовым файлом tmpName (например, после слияния)
+template <class T>
+void BinaryList<T>::replaceFile(const std::string& tmpName) {
+    if (space) {
+        // Файл контейнера не подменить: узлы tmpName дописываются
+        // в общий конец одним проходом, старые становятся мёртвыми
+        {
+            BinaryList<T> src(tmpName);
+            resetFile();
+            int cur = src.fh.head;
+            int left = src.fh.size;
+            appendBulk([&](T& v) {
+                if (left == 0) return false;
+                int n = src.readNext(cur);
+                Codec::read(src, v);
+                cur = n;
+                left--;
+                return true;
+            });
+            fh.flags = (fh.flags & ~HF_SORTED) | (src.fh.flags & HF_SORTED);
+            writeHeader();
+        }
+        std::remove(tmpName.c_str());
+    }
+    else {
+        detachSnapshots();  // до закрытия: без pread снимок дочитывает старый файл
+        if (is_open()) {
+            close();
+        }
+        io.close();
+        std::remove(path.c_str());
+        std::rename(tmpName.c_str(), path.c_str());
+        open(path.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+        readHeader();
+    }
+    iterPos = -1;
+    posIndex.clear();
+    posValid = false;
+    if (hidxOn) {
+        rebuildHashIndex();
+    }
+    if (bloomOn) {
+        rebuildBloom();
+    }
+}
+
+// Перенести все элементы other в конец этого списка (other опустеет).
+// Списки одного контейнера с одинаковой раскладкой узлов живут в одном
+// файле: цепочка other просто перецепляется за O(1) — две ссылки и
+// два заголовка. Иначе файлы разные, и узлы копируются одним потоковым
+// проходом: чтение по цепочке other, запись подряд в конец нашего файла.
+template <class T>
+void BinaryList<T>::splice(BinaryList<T>& other) {
+    if (!is_open() || !other.is_open()) return;
+    if (sameList(other)) {
+        std::cout << "[" << Codec::tag() << "] splice: это тот же самый список\n";
+        return;
+    }
+    const int layout = HF_CHECKSUM | HF_SLABS;
+    if (space && other.path == path && other.fh.align == fh.align
+        && (other.fh.flags & layout) == (fh.flags & layout)) {
+        if (other.fh.size == 0) return;
+        if (fh.size == 0) {
+            fh.head = other.fh.head;
+            fh.flags = (fh.flags & ~HF_CONTIGUOUS) | (other.fh.flags & HF_CONTIGUOUS);
+        }
+        else {
+            writeNext(fh.tail, other.fh.head);
+            other.writePrev(other.fh.head, fh.tail);
+            fh.flags &= ~HF_CONTIGUOUS;
+        }
+        other.flush();
+        if (hidxOn || bloomOn) {
+            int cur = other.fh.head;
+            for (int left = other.fh.size; left > 0; left--) {
+                readValue(cur, scratch);
+                idxAdd(scratch, cur);
+                cur = readNext(cur);
+            }
+        }
+        fh.tail = other.fh.tail;
+        fh.size += other.fh.size;
+        fh.flags &= ~HF_SORTED;
+        posIndex.clear();
+        posValid = false;
+        writeHeader();
+        flush();
+        other.clear();  // в контейнере — только пустой заголовок
+        other.flush();
+        return;
+    }
+    int cur = other.fh.head;
+    int left = other.fh.size;
+    appendBulk([&](T& out) {
+        if (left == 0) return false;
+        int n = other.readNext(cur);
+        Codec::read(other, out);  // данные идут сразу за полем next
+        cur = n;
+        left--;
+        return true;
+    });
+    other.clear();
+}
+
+// Слить с отсортированным other (оба по возрастанию) за один проход.
+// Результат пишется подряд в новый файл, который затем заменяет наш;
+// other опустеет. При равенстве первым идёт элемент этого списка.
+// Флаг HF_SORTED ставится, только если оба списка были отсортированы.
+template <class T>
+void BinaryList<T>::merge(BinaryList<T>& other) {
+    if (!is_open() || !other.is_open()) return;
+    if (sameList(other)) {
+        std::cout << "[" << Codec::tag() << "] merge: это тот же самый список\n";
+        return;
+    }
+    bool sorted = isSorted() && other.isSorted();
+    std::string tmpName = fname + ".merge";
+    {
+        std::remove(tmpName.c_str());
+        BinaryList<T> out(tmpName);
+        adoptLayout(out);
+
+        int a = fh.head, b = other.fh.head;
+        int leftA = fh.size, leftB = other.fh.size;
+        T va{}, vb{};
+        auto takeA = [&]() { int n = readNext(a); Codec::read(*this, va); a = n; leftA--; };
+        auto takeB = [&]() { int n = other.readNext(b); Codec::read(other, vb); b = n; leftB--; };
+        bool haveA = leftA > 0, haveB = leftB > 0;
+        if (haveA) takeA();
+        if (haveB) takeB();
+
+        out.appendBulk([&](T& v) {
+            if (haveA && (!haveB || !(vb < va))) {
+                v = va;
+                haveA = leftA > 0;
+                if (haveA) takeA();
+                return true;
+            }
+            if (haveB) {
+                v = vb;
+                haveB = leftB > 0;
+                if (haveB) takeB();
+                return true;
+            }
+            return false;
+        });
+    }
+    replaceFile(tmpName);
+    if (sorted) fh.flags |= HF_SORTED;
+    else fh.flags &= ~HF_SORTED;
+    writeHeader();
+    other.clear();
+}
+
+// Прочитать весь список в вектор (по порядку ссылок)
+template <class T>
+void BinaryList<T>::readAll(std::vector<T>& vec) {
+    vec.clear();
+    vec.reserve(fh.size);
+    if (asyncOn) {
+        scanAhead([&](const T& v) { vec.push_back(v); });
+        return;
+    }
+    scanBlocks([&](const T& v) { vec.push_back(v); });
+}
+
+// Строки собираются в арену из окна файла (см. scanBlocks)
+template <class T>
+void BinaryList<T>::readAll(StringArena& arena) {
+    static_assert(std::is_same<T, std::string>::value, "Арена только для строк");
+    arena.clear();
+    if (!is_open()) return;
+    seekg(0, std::ios::end);
+    arena.reserve(fh.size, (size_t)tellg());  // размер файла — верхняя граница байт
+    if (asyncOn) {
+        scanAhead([&](const T& v) { arena.push_back(v); });
+        return;
+    }
+    scanBlocks([&](const T& v) { arena.push_back(v); });
+}
+
+// Перезаписать файл строками арены в порядке order: значение
+// собирается в буфере appendBulk, ёмкость которого переиспользуется
+template <class T>
+void BinaryList<T>::rewriteAll(const StringArena& arena, const std::vector<int>& order) {
+    static_assert(std::is_same<T, std::string>::value, "Арена только для строк");
+    resetFile();
+    iterPos = -1;
+    size_t i = 0;
+    appendBulk([&](T& out) {
+        if (i == order.size()) return false;
+        out.assign(arena[order[i++]]);
+        return true;
+    });
+}
+
+// Печать всего списка (print)
+template <class T>
+void BinaryList<T>::print() {
+    if (fh.size == 0) {
+        std::cout << "[" << Codec::tag() << "] Список пуст.\n";
+        return;
+    }
+    std::cout << "[" << Codec::tag() << "] Содержимое списка (size=" << fh.size << "):\n";
+    if (asyncOn) {
+        int i = 0;
+        scanAhead([&](const T& v) {
+            std::cout << "  [" << i++ << "]: " << Codec::view(v) << "\n";
+        });
+        return;
+    }
+    int cur = fh.head;
+    for (int i = 0; i < fh.size; i++) {
+        int n = readNext(cur);
+        Codec::read(*this, scratch);  // без нового объекта на каждый элемент
+        std::cout << "  [" << i << "]: " << Codec::view(scratch) << "\n";
+        cur = n;
+    }
+}
+
+template <class T>
+int BinaryList<T>::getSize() const {
+    return fh.size;
+}
+
+template <class T>
+bool BinaryList<T>::setAlignment(int bytes) {
+    if (!is_open()) return false;
+    if (bytes == 1) bytes = 0;
+    if (bytes != 0 && (bytes < 8 || bytes > 4096 || (bytes & (bytes - 1)) != 0)) {
+        std::cout << "[" << Codec::tag() << "] Неверное выравнивание: " << bytes
+                  << " (0 или степень двойки от 8 до 4096)\n";
+        return false;
+    }
+    if (bytes == fh.align) return true;
+    // Переписываем узлы по новой политике: снова подряд и по слотам
+    relayout([&] { fh.align = bytes; });
+    return true;
+}
+
+// Прочитать все значения, поменять раскладку в заголовке (change)
+// и переписать узлы подряд; порядок и флаг сортировки сохраняются
+template <class T>
+template <class Change>
+void BinaryList<T>::relayout(Change change) {
+    bool sorted = (fh.flags & HF_SORTED) != 0;
+    if constexpr (Codec::fixedSize) {
+        std::vector<T> vec;
+        readAll(vec);
+        change();
+        rewriteAll(vec);
+    }
+    else {
+        StringArena arena;
+        readAll(arena);
+        std::vector<int> order(arena.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+        change();
+        rewriteAll(arena, order);
+    }
+    if (sorted) fh.flags |= HF_SORTED;
+    writeHeader();
+}
+
+// Пустой список out (временный файл) получает раскладку этого списка
+// Списки одного контейнера делят path и различаются позицией заголовка
+template <class T>
+bool BinaryList<T>::sameList(const BinaryList<T>& other) const {
+    return &other == this || (other.path == path && other.base == base);
+}
+
+template <class T>
+void BinaryList<T>::adoptLayout(BinaryList<T>& out) const {
+    out.fh.align = fh.align;
+    const int keep = HF_CHECKSUM | HF_SLABS;
+    out.fh.flags = (out.fh.flags & ~keep) | (fh.flags & keep);
+    out.writeHeader();
+}
+
+template <class T>
+int BinaryList<T>::getAlignment() const {
+    return fh.align;
+}
+
+template <class T>
+void BinaryList<T>::refresh() {
+    if (!is_open()) return;
+    flush();
+    int gen = fh.gen;
+    readHeader();
+    if (fh.gen == gen) return;
+    ahead.clear();
+    aheadPos.clear();
+    posIndex.clear();
+    posValid = false;
+    if (hidxOn) rebuildHashIndex();
+    if (bloomOn) rebuildBloom();
+}
+
+template <class T>
+void BinaryList<T>::setSortMemoryLimit(size_t bytes) {
+    sortMemLimit = bytes;
+}
+
+template <class T>
+LayoutReport BinaryList<T>::analyze() {
+    LayoutReport r;
+    std::memset(&r, 0, sizeof(r));
+    if (!is_open()) return r;
+    flush();
+    seekg(0, std::ios::end);
+    r.fileBytes = (long long)tellg();
+    r.nodes = fh.size;
+
+    long long jumpSum = 0, lenSum = 0, lastPage = -1;
+    int hops = 0, forward = 0, sequential = 0;
+    int prevPos = -1, prevEnd = (int)sizeof(FileHeader);
+    int cur = fh.head;
+    for (int i = 0; i < fh.size; i++) {
+        int links[2];
+        int len = Codec::size;
+        seekg(cur, std::ios::beg);
+        read(reinterpret_cast<char*>(links), sizeof(links));
+        if (!Codec::fixedSize) {
+            read(reinterpret_cast<char*>(&len), sizeof(int));
+        }
+        int nodeLen = LINKS + (Codec::fixedSize ? len : (int)sizeof(int) + len) + crcBytes();
+        int span = nodeSpan(nodeLen - LINKS - crcBytes());  // хвост слота — тоже набивка
+
+        bool inSlot = (cur == slotFor(prevEnd, span));
+        if (inSlot) r.padBytes += cur - prevEnd;
+        r.padBytes += span - nodeLen;
+        if (i > 0) {
+            long long jump = cur > prevEnd ? cur - prevEnd : prevEnd - cur;
+            jumpSum += jump;
+            r.maxJump = std::max(r.maxJump, jump);
+            hops++;
+            if (cur > prevPos) forward++;
+            if (inSlot) sequential++;
+        }
+        r.liveBytes += nodeLen;
+        if (i == 0 || len < r.minLen) r.minLen = len;
+        if (len > r.maxLen) r.maxLen = len;
+        lenSum += len;
+        int bucket = 0;
+        while (bucket < 31 && (1LL << bucket) <= len) bucket++;
+        r.lenHist[bucket]++;
+        for (long long pg = cur / 4096; pg <= (cur + nodeLen - 1) / 4096; pg++) {
+            if (pg != lastPage) {
+                r.pagesTouched++;
+                lastPage = pg;
+            }
+        }
+        prevPos = cur;
+        prevEnd = cur + span;
+        cur = links[1];
+    }
+    // В контейнере файл общий: чужие узлы от мёртвых не отличить
+    r.deadBytes = space ? 0 : r.fileBytes - (long long)sizeof(FileHeader) - r.liveBytes - r.padBytes;
+    r.avgJump = hops ? (double)jumpSum / hops : 0;
+    r.forwardFraction = hops ? (double)forward / hops : 1;
+    r.sequentialFraction = hops ? (double)sequential / hops : 1;
+    r.avgLen = fh.size ? (double)lenSum / fh.size : 0;
+    r.idealPages = (r.liveBytes + r.padBytes + 4095) / 4096;
+    // Больше четверти мёртвого места или обход заметно «прыгает»
+    // (список в контейнере compact не уплотняет — не советуем)
+    r.compactAdvised = !space && (r.deadBytes > r.liveBytes / 4
+                                  || (hops >= 64 && r.sequentialFraction < 0.8));
+    return r;
+}
+
+// Потоковое уплотнение через временный файл (как в merge):
+// порядок элементов, флаг сортировки и выравнивание сохраняются
+template <class T>
+void BinaryList<T>::compact() {
+    if (!is_open()) return;
+    // Файл контейнера общий: копия узлов легла бы в его конец, и файл
+    // только вырос бы — мёртвое место списка освобождать некуда
+    if (space) {
+        std::cout << "[" << Codec::tag() << "] compact: список в контейнере не уплотняется\n";
+        return;
+    }
+    flush();
+    seekg(0, std::ios::end);
+    long long before = (long long)tellg();
+    std::string tmpName = fname + ".compact";
+    {
+        std::remove(tmpName.c_str());
+        BinaryList<T> out(tmpName);
+        adoptLayout(out);
+        int cur = fh.head;
+        int left = fh.size;
+        out.appendBulk([&](T& v) {
+            if (left == 0) return false;
+            int n = readNext(cur);
+            Codec::read(*this, v);
+            cur = n;
+            left--;
+            return true;
+        });
+    }
+    bool sorted = (fh.flags & HF_SORTED) != 0;
+    replaceFile(tmpName);
+    if (sorted) {
+        fh.flags |= HF_SORTED;
+        writeHeader();
+    }
+    seekg(0, std::ios::end);
+    std::cout << "[" << Codec::tag() << "] Уплотнено: " << before << " -> "
+              << (long long)tellg() << " байт\n";
+}
+
+// Проверка: один проход по ссылкам через окно файла (границы,
+// симметрия prev, число узлов и tail), затем позиции сортируются —
+// повторы означают цикл, пересечения — испорченные ссылки — и CRC
+// данных проверяются на пуле потоков по возрастанию позиций
+template <class T>
+VerifyReport BinaryList<T>::verify() {
+    VerifyReport r;
+    std::memset(&r, 0, sizeof(r));
+    r.checksums = (fh.flags & HF_CHECKSUM) != 0;
+    r.headerOk = !r.checksums || fh.crc == headerCrc(fh);
+    if (!is_open()) return r;
+    flush();
+    seekg(0, std::ios::end);
+    int fileEnd = (int)tellg();
+
+    std::vector<std::pair<int, int>> nodes;  // позиция, длина
+    {
+        FileWindow win(*this, fileEnd);
+        int cur = fh.head, prev = -1, prevEnd = cur;
+        while (cur != -1 && (int)nodes.size() <= fh.size) {
+            bool seq = cur >= prevEnd && cur - prevEnd < FileWindow::SMALL;
+            int links[2], len;
+            const char* data;
+            if (!peekNode(win, cur, seq, links, len, data)) {
+                r.badLinks++;
+                break;
+            }
+            if (links[0] != prev) r.badLinks++;
+            nodes.push_back({cur, len});
+            prev = cur;
+            prevEnd = cur + len;
+            cur = links[1];
+        }
+        r.nodes = (int)nodes.size();
+        r.chainOk = cur == -1 && r.nodes == fh.size && prev == fh.tail;
+
+        // Свободные слоты: prev = -2; в проверку пересечений и CRC
+        // идут вместе с живыми узлами (данные в них не менялись).
+        // У строк цепочек несколько — по классу на slabHead, и строка
+        // в слоте должна быть того же класса
+        for (int c = 0; c < (Codec::fixedSize ? 1 : SLAB_CLASSES); c++) {
+            int f = Codec::fixedSize ? (fh.freeCount > 0 ? fh.freeHead : -1) : fh.slabHead[c];
+            while (f > 0 && r.freeSlots < fh.freeCount) {
+                int links[2], len, slen = 0;
+                const char* data;
+                bool ok = peekNode(win, f, false, links, len, data) && links[0] == -2;
+                if (ok && !Codec::fixedSize) {
+                    std::memcpy(&slen, data, sizeof(int));
+                    ok = slabClass(slen) == c;
+                }
+                if (!ok) {
+                    r.badLinks++;
+                    break;
+                }
+                nodes.push_back({f, len});
+                r.freeSlots++;
+                f = links[1];
+            }
+        }
+        if (r.freeSlots != fh.freeCount) r.badLinks++;
+    }
+
+    std::sort(nodes.begin(), nodes.end());
+    for (size_t i = 1; i < nodes.size(); i++) {
+        if (nodes[i].first < nodes[i - 1].first + nodes[i - 1].second) {
+            r.badLinks++;
+            r.chainOk = false;
+        }
+    }
+    if (!r.checksums || nodes.empty()) return r;
+
+    const int MIN_RANGE = 1024;
+    WorkerPool& pool = WorkerPool::shared();
+    int parts = std::min(pool.size(), ((int)nodes.size() + MIN_RANGE - 1) / MIN_RANGE);
+    std::atomic<int> bad(0);
+    std::string name = path;
+    pool.run(parts, [&](int k) {
+        size_t from = nodes.size() * k / parts, to = nodes.size() * (k + 1) / parts;
+        std::ifstream in(name.c_str(), std::ios::binary);
+        FileWindow win(in, fileEnd);
+        int prevEnd = nodes[from].first, n = 0;
+        for (size_t i = from; i < to; i++) {
+            int pos = nodes[i].first, len = nodes[i].second;
+            const char* node = win.at(pos, len, pos - prevEnd < FileWindow::SMALL);
+            if (!node || !payloadOk(node + LINKS, len)) n++;
+            prevEnd = pos + len;
+        }
+        bad += n;
+    });
+    r.badChecksums = bad;
+    return r;
+}
+
+// Восстановление: от head вперёд, пока узлы целы (ссылки, prev, CRC),
+// затем от tail назад до встречи с уже собранной частью; уцелевшие
+// узлы переписываются подряд через временный файл (как в compact)
+template <class T>
+int BinaryList<T>::rebuild() {
+    if (!is_open()) return 0;
+    flush();
+    seekg(0, std::ios::end);
+    FileWindow win(*this, (int)tellg());
+    std::unordered_set<int> seen;
+    std::vector<int> keep;
+    int links[2], len;
+    const char* data;
+
+    int cur = fh.head, prev = -1;
+    while (cur != -1 && !seen.count(cur)) {
+        if (!peekNode(win, cur, false, links, len, data)) break;
+        if (links[0] != prev || !payloadOk(data, len)) break;
+        seen.insert(cur);
+        keep.push_back(cur);
+        prev = cur;
+        cur = links[1];
+    }
+    if (cur != -1) {
+        // Цепочка оборвалась — подбираем хвост с конца
+        size_t mid = keep.size();
+        int back = fh.tail, next = -1;
+        while (back != -1 && !seen.count(back)) {
+            if (!peekNode(win, back, false, links, len, data)) break;
+            if (links[1] != next || !payloadOk(data, len)) break;
+            seen.insert(back);
+            keep.push_back(back);
+            next = back;
+            back = links[0];
+        }
+        std::reverse(keep.begin() + mid, keep.end());
+    }
+
+    int lost = fh.size - (int)keep.size();
+    std::string tmpName = fname + ".rebuild";
+    {
+        std::remove(tmpName.c_str());
+        BinaryList<T> out(tmpName);
+        adoptLayout(out);
+        size_t i = 0;
+        out.appendBulk([&](T& v) {
+            if (i == keep.size()) return false;
+            peekNode(win, keep[i++], true, links, len, data);
+            Codec::decode(data, v);
+            return true;
+        });
+    }
+    bool sorted = (fh.flags & HF_SORTED) != 0;  // подпоследовательность осталась упорядоченной
+    replaceFile(tmpName);
+    if (sorted) {
+        fh.flags |= HF_SORTED;
+        writeHeader();
+    }
+    std::cout << "[" << Codec::tag() << "] Восстановлено узлов: " << keep.size();
+    if (lost > 0) std::cout << ", потеряно: " << lost;
+    std::cout << "\n";
+    return (int)keep.size();
+}
+
+// Включить/выключить CRC узлов и заголовка; узлы переписываются
+template <class T>
+void BinaryList<T>::enableChecksums() {
+    if (!is_open() || (fh.flags & HF_CHECKSUM)) return;
+    relayout([&] { fh.flags |= HF_CHECKSUM; });
+}
+
+template <class T>
+void BinaryList<T>::disableChecksums() {
+    if (!is_open() || !(fh.flags & HF_CHECKSUM)) return;
+    relayout([&] { fh.flags &= ~HF_CHECKSUM; });
+}
+
+template <class T>
+bool BinaryList<T>::hasChecksums() const {
+    return (fh.flags & HF_CHECKSUM) != 0;
+}
+
+// Включить/выключить слоты классов размера для строк; узлы
+// переписываются подряд, каждый — в слот своего класса
+template <class T>
+void BinaryList<T>::enableSlabs() {
+    if (!is_open() || Codec::fixedSize || (fh.flags & HF_SLABS)) return;
+    relayout([&] { fh.flags |= HF_SLABS; });
+}
+
+template <class T>
+void BinaryList<T>::disableSlabs() {
+    if (!is_open() || !(fh.flags & HF_SLABS)) return;
+    relayout([&] { fh.flags &= ~HF_SLABS; });
+}
+
+template <class T>
+bool BinaryList<T>::hasSlabs() const {
+    return (fh.flags & HF_SLABS) != 0;
+}
+
+//-----------------------------------------------------
+// Импорт и экспорт
+//-----------------------------------------------------
+template <class T>
+long long BinaryList<T>::importFile(const std::string& path, DataFormat fmt) {
+    if (!is_open()) return -1;
+    BlockReader in(path);
+    if (!in.is_open()) {
+        std::cout << "[" << Codec::tag() << "] Не удалось открыть " << path << "\n";
+        return -1;
+    }
+    int before = fh.size;
+    long long bad = 0;
+    if (fmt == DF_RAW) {
+        appendBulk([&](T& v) {
+            const char* p;
+            if constexpr (Codec::fixedSize) {
+                if (!in.take(Codec::size, p)) return false;
+                Codec::decode(p, v);
+            }
+            else {
+                int len;
+                if (!in.take(sizeof(int), p)) return false;
+                std::memcpy(&len, p, sizeof(int));
+                if (len < 0 || len > 1000000 || !in.take(len, p)) {
+                    bad++;  // обрезанный или испорченный хвост
+                    return false;
+                }
+                v.assign(p, len);
+            }
+            return true;
+        });
+    }
+    else {
+        bool csv = (fmt == DF_CSV);
+        std::string tmp;
+        appendBulk([&](T& v) {
+            std::string_view rec;
+            while (in.nextRecord(csv, rec)) {
+                if (rec.empty() && !TextCodec<T>::blankIsValue) continue;
+                if (TextCodec<T>::parse(rec, csv, v, tmp)) return true;
+                bad++;
+            }
+            return false;
+        });
+    }
+    std::cout << "[" << Codec::tag() << "] Импортировано: " << fh.size - before;
+    if (bad) std::cout << ", пропущено записей: " << bad;
+    std::cout << "\n";
+    return fh.size - before;
+}
+
+template <class T>
+long long BinaryList<T>::exportFile(const std::string& path, DataFormat fmt) {
+    if (!is_open()) return -1;
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "[" << Codec::tag() << "] Не удалось создать " << path << "\n";
+        return -1;
+    }
+    const size_t CHUNK = 1 << 20;
+    std::string buf;
+    buf.reserve(CHUNK + 4096);
+    bool csv = (fmt == DF_CSV);
+    long long count = 0;
+    scanBlocks([&](const T& v) {
+        if (fmt == DF_RAW) {
+            size_t at = buf.size();
+            buf.resize(at + Codec::encodedSize(v));
+            Codec::encode(v, &buf[at]);
+        }
+        else {
+            TextCodec<T>::format(v, csv, buf);
+            buf += '\n';
+        }
+        if (buf.size() >= CHUNK) {
+            out.write(buf.data(), (std::streamsize)buf.size());
+            buf.clear();
+        }
+        count++;
+    });
+    out.write(buf.data(), (std::streamsize)buf.size());
+    if (!out) {
+        std::cout << "[" << Codec::tag() << "] Ошибка записи " << path << "\n";
+        return -1;
+    }
+    return count;
+}
+
+// Обход в порядке списка через окно файла (см. FileWindow)
+template <class T>
+template <class Visit>
+void BinaryList<T>::scanBlocks(Visit visit) {
+    flush();
+    seekg(0, std::ios::end);
+    FileWindow win(*this, (int)tellg());
+    int cur = fh.head;
+    int prevEnd = cur;
+    for (int i = 0; i < fh.size; i++) {
+        bool seq = cur >= prevEnd && cur - prevEnd < FileWindow::SMALL;
+        int links[2], len;
+        const char* data;
+        if (!peekNode(win, cur, seq, links, len, data)) break;
+        Codec::decode(data, scratch);
+        visit(scratch);
+        prevEnd = cur + len;
+        cur = links[1];
+    }
+}
+
+// Узел pos через окно: ссылки, полная длина узла (с CRC) и указатель
+// на данные. false — узел не читается: позиция вне файла или длина
+// строки неправдоподобна
+template <class T>
+bool BinaryList<T>::peekNode(FileWindow& win, int pos, bool seq, int* links, int& len,
+                             const char*& data) const {
+    const int HEAD = LINKS + (Codec::fixedSize ? Codec::size : (int)sizeof(int));
+    if (pos < (int)sizeof(FileHeader)) return false;
+    const char* node = win.at(pos, HEAD, seq);
+    if (!node) return false;
+    int payload = Codec::size;
+    if constexpr (!Codec::fixedSize) {
+        int n;
+        std::memcpy(&n, node + LINKS, sizeof(int));
+        if (n < 0 || n > 1000000) return false;  // тот же safeguard, что в NodeCodec
+        payload = (int)sizeof(int) + n;
+    }
+    len = LINKS + payload + crcBytes();
+    node = win.at(pos, len, seq);
+    if (!node) return false;
+    std::memcpy(links, node, LINKS);
+    data = node + LINKS;
+    return true;
+}
+
+template <class T>
+void BinaryList<T>::sort() {
+    if (fh.size <= 1) {
+        std::cout << "[" << Codec::tag() << "] Список пуст или 1 элемент, сортировать нечего.\n";
+        return;
+    }
+    if constexpr (!Codec::fixedSize) {
+        // Переменная длина: строки читаются в арену, сортируются
+        // номера строк, затем файл переписывается в этом порядке
+        StringArena arena;
+        readAll(arena);
+        // Ключ — первые 8 байт строки как число и номер строки: почти
+        // все сравнения обходятся без обращения к арене
+        struct Key { unsigned long long prefix; int idx; };
+        std::vector<Key> keys(arena.size());
+        for (size_t i = 0; i < keys.size(); i++) keys[i] = Key{ arena.prefix(i), (int)i };
+        auto less = [&](const Key& a, const Key& b) {
+            if (a.prefix != b.prefix) return a.prefix < b.prefix;
+            return arena[a.idx] < arena[b.idx];
+        };
+        if (arena.byteSize() <= sortMemLimit) parallelSort(keys.begin(), keys.end(), less);
+        else std::sort(keys.begin(), keys.end(), less);
+        std::vector<int> order(keys.size());
+        for (size_t i = 0; i < keys.size(); i++) order[i] = keys[i].idx;
+        rewriteAll(arena, order);
+        fh.flags |= HF_SORTED;
+        writeHeader();
+        std::cout << "[" << Codec::tag() << "] Список отсортирован.\n";
+        return;
+    }
+    else if ((size_t)fh.size * Codec::size <= sortMemLimit) {
+        // Помещается в память: один последовательный проход чтения,
+        // параллельная сортировка и одна перезапись файла
+        std::vector<T> vec;
+        readAll(vec);
+        parallelSort(vec.begin(), vec.end(), [](const T& a, const T& b) { return a < b; });
+        rewriteAll(vec);
+        fh.flags |= HF_SORTED;
+        writeHeader();
+        std::cout << "[" << Codec::tag() << "] Список отсортирован.\n";
+        return;
+    }
+    else {
+        // Сортировка (пузырьковая) прямо в файле — узлы одного размера,
+        // поэтому данные можно менять местами на месте
+        bool swapped;
+        do {
+            swapped = false;
+            int curPos = fh.head;
+            for (int i = 0; i < fh.size - 1; i++) {
+                int nextPos = readNext(curPos);
+
+                // читаем curVal, nextVal
+                T curVal{}, nextVal{};
+                readValue(curPos, curVal);
+                readValue(nextPos, nextVal);
+
+                if (curVal > nextVal) {
+                    // Меняем их местами прямо в файле
+                    writePayload(curPos, nextVal);
+                    writePayload(nextPos, curVal);
+                    swapped = true;
+                }
+                curPos = nextPos;
+            }
+        } while (swapped);
+        if (hidxOn) {
+            rebuildHashIndex();  // значения переехали в другие узлы
+        }
+        fh.flags |= HF_SORTED;
+        writeHeader();
+        std::cout << "[" << Codec::tag() << "] Список отсортирован.\n";
+    }
+}
+
+// Один проход по цепочке через окно файла. Для оставшихся узлов
+// копится правка ссылок, если сосед с какой-то стороны удалён;
+// удалённые узлы фиксированного размера сразу сцепляются в список
+// свободных. Все правки пишутся после прохода, по возрастанию позиций.
+template <class T>
+template <class Drop>
+int BinaryList<T>::removeWhere(Drop drop) {
+    if (!is_open() || fh.size == 0) return 0;
+    flush();
+    seekg(0, std::ios::end);
+    FileWindow win(*this, (int)tellg());
+    std::vector<LinkPatch> patches;
+    std::vector<HashSlot> gone;  // ключи удалённых — для хеш-индекса
+    std::deque<int> kept;
+    int head = -1, last = -1, lastPrev = -1, lastOrigNext = -1;
+    bool lastMoved = false;      // у last изменился prev
+    int freeTop = fh.freeCount > 0 ? fh.freeHead : -1;
+    int slab[SLAB_CLASSES];      // головы классов строк (HF_SLABS)
+    std::memcpy(slab, fh.slabHead, sizeof(slab));
+    bool slabs = !Codec::fixedSize && (fh.flags & HF_SLABS);
+    int freed = 0, removed = 0;
+    int cur = fh.head, prevEnd = cur;
+    for (int i = 0; i < fh.size; i++) {
+        bool seq = cur >= prevEnd && cur - prevEnd < FileWindow::SMALL;
+        int links[2], len;
+        const char* data;
+        if (!peekNode(win, cur, seq, links, len, data)) {
+            std::cout << "[" << Codec::tag() << "] Цепочка повреждена, удаление отменено (verify)\n";
+            return 0;
+        }
+        Codec::decode(data, scratch);
+        if (drop(scratch)) {
+            if (hidxOn) gone.push_back(HashSlot{KeyOf<T>::hash(KeyOf<T>::key(scratch)), cur});
+            if constexpr (Codec::fixedSize) {
+                patches.push_back(LinkPatch{ cur, { -2, freeTop } });
+                freeTop = cur;
+                freed++;
+            }
+            else if (slabs) {
+                int slen;
+                std::memcpy(&slen, data, sizeof(int));
+                int c = slabClass(slen);
+                patches.push_back(LinkPatch{ cur, { -2, slab[c] } });
+                slab[c] = cur;
+                freed++;
+            }
+            removed++;
+        }
+        else {
+            if (last == -1) {
+                head = cur;
+            }
+            else if (lastMoved || lastOrigNext != cur) {
+                patches.push_back(LinkPatch{ last, { lastPrev, cur } });
+            }
+            lastMoved = links[0] != last;
+            lastPrev = last;
+            lastOrigNext = links[1];
+            last = cur;
+            if (posValid) kept.push_back(cur);
+        }
+        prevEnd = cur + len;
+        cur = links[1];
+    }
+    if (removed == 0) return 0;
+    if (last != -1 && (lastMoved || lastOrigNext != -1)) {
+        patches.push_back(LinkPatch{ last, { lastPrev, -1 } });
+    }
+    writePatches(patches);
+
+    for (const HashSlot& g : gone) hidx.remove(g.hash, g.pos);
+    if (bloomOn) {
+        bloom.noteRemoved(removed);
+    }
+    fh.head = head;
+    fh.tail = last;
+    fh.size -= removed;
+    fh.freeHead = freeTop;
+    std::memcpy(fh.slabHead, slab, sizeof(slab));
+    fh.freeCount += freed;
+    fh.flags &= ~HF_CONTIGUOUS;
+    if (fh.size == 0 && Codec::fixedSize) {
+        fh.flags |= HF_CONTIGUOUS;
+    }
+    if (posValid) {
+        posIndex.swap(kept);
+    }
+    iterPos = -1;
+    writeHeader();
+    return removed;
+}
+
+template <class T>
+template <class Pred>
+int BinaryList<T>::remove_if(Pred pred) {
+    return removeWhere(pred);
+}
+
+template <class T>
+int BinaryList<T>::remove(const T& value) {
+    return removeWhere([&](const T& v) { return !(v < value) && !(value < v); });
+}
+
+// Сравнивается с последним оставленным значением (как std::list::unique)
+template <class T>
+template <class Eq>
+int BinaryList<T>::unique(Eq eq) {
+    T lastKept{};
+    bool have = false;
+    return removeWhere([&](const T& v) {
+        if (have && eq(lastKept, v)) return true;
+        lastKept = v;
+        have = true;
+        return false;
+    });
+}
+
+template <class T>
+int BinaryList<T>::unique() {
+    return unique([](const T& a, const T& b) { return !(a < b) && !(b < a); });
+}
+
+// Итератор
+template <class T>
+void BinaryList<T>::initIterator() {
+    ahead.clear();
+    aheadPos.clear();
+    iterPos = fh.head;
+}
+
+template <class T>
+bool BinaryList<T>::hasNext() {
+    return (iterPos != -1 || !ahead.empty());
+}
+
+template <class T>
+T BinaryList<T>::next() {
+    T res{};
+    next(res);
+    return res;
+}
+
+template <class T>
+bool BinaryList<T>::next(T& out) {
+    if (asyncOn) {
+        if (ahead.empty()) fillAhead();
+        if (ahead.empty()) return false;
+        std::swap(out, ahead.front());  // старый буфер out уйдёт вместе с окном
+        ahead.pop_front();
+        aheadPos.pop_front();
+        return true;
+    }
+    if (iterPos == -1) return false;
+    int n = readNext(iterPos);
+    Codec::read(*this, out);  // данные идут сразу за полем next
+    iterPos = n;
+    return true;
+}
+
+template <class T>
+typename BinaryList<T>::View BinaryList<T>::getView(int index) {
+    if (!is_open() || index < 0 || index >= fh.size) {
+        std::cout << "[" << Codec::tag() << "] Неверный индекс getView: " << index << "\n";
+        pinned = T{};
+        return Codec::view(pinned);
+    }
+    readValue(nodeAt(index), pinned);
+    return Codec::view(pinned);
+}
+
+template <class T>
+typename BinaryList<T>::View BinaryList<T>::nextView() {
+    if (!next(pinned)) {
+        pinned = T{};
+    }
+    return Codec::view(pinned);
+}
+
+//-----------------------------------------------------
+// Отсортированный режим и бинарный поиск
+//-----------------------------------------------------
+
+// Один проход по ссылкам: позиции всех узлов по порядку
+template <class T>
+void BinaryList<T>::buildPosIndex() {
+    posIndex.clear();
+    int cur = fh.head;
+    for (int i = 0; i < fh.size; i++) {
+        posIndex.push_back(cur);
+        cur = readNext(cur);
+    }
+    posValid = true;
+}
+
+template <class T>
+void BinaryList<T>::ensurePosIndex() {
+    if (!posValid && !(Codec::fixedSize && (fh.flags & HF_CONTIGUOUS))) {
+        buildPosIndex();
+    }
+}
+
+// Меньше двух элементов — упорядочено и без флага
+template <class T>
+bool BinaryList<T>::isSorted() const {
+    return (fh.flags & HF_SORTED) != 0 || fh.size < 2;
+}
+
+template <class T>
+int BinaryList<T>::lower_bound(const T& value) {
+    if (!is_open() || !isSorted()) return -1;
+    ensurePosIndex();
+    int lo = 0, hi = fh.size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        readValue(nodeAt(mid), scratch);
+        if (scratch < value) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+template <class T>
+int BinaryList<T>::upper_bound(const T& value) {
+    if (!is_open() || !isSorted()) return -1;
+    ensurePosIndex();
+    int lo = 0, hi = fh.size;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        readValue(nodeAt(mid), scratch);
+        if (value < scratch) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+// В отсортированном списке — бинарный поиск,
+// иначе линейный проход (без сортировки файла)
+template <class T>
+int BinaryList<T>::find(const T& value) {
+    if (!is_open()) return -1;
+    if (isSorted()) {
+        int i = lower_bound(value);
+        if (i < fh.size) {
+            readValue(nodeAt(i), scratch);
+            if (!(value < scratch)) return i;
+        }
+        return -1;
+    }
+    int cur = fh.head;
+    for (int i = 0; i < fh.size; i++) {
+        int n = readNext(cur);
+        Codec::read(*this, scratch);
+        if (!(scratch < value) && !(value < scratch)) return i;
+        cur = n;
+    }
+    return -1;
+}
+
+// Вставка с сохранением порядка: место ищется бинарным поиском,
+// сама вставка — одна запись узла, две правки ссылок и заголовок
+template <class T>
+void BinaryList<T>::insert_sorted(const T& value) {
+    if (!is_open()) return;
+    if (!isSorted()) {
+        std::cout << "[" << Codec::tag() << "] Список не отсортирован (сначала sort)\n";
+        return;
+    }
+    int index = upper_bound(value);
+    fh.flags |= HF_SORTED;  // запишется вместе с узлом
+    insertNode(index, value, true);
+}
+
+template <class T>
+bool BinaryList<T>::pop_front(T& out) {
+    if (fh.size == 0) {
+        std::cout << "[" << Codec::tag() << "] Список пуст (pop_front)\n";
+        return false;
+    }
+    readValue(fh.head, out);
+    erase(0);
+    return true;
+}
+
+template <class T>
+unsigned long long BinaryList<T>::appendSeq() const {
+    return waitCh->seq();
+}
+
+template <class T>
+bool BinaryList<T>::waitChange(unsigned long long seen, int timeoutMs) const {
+    return waitCh->wait(seen, timeoutMs);
+}
+
+// Пока пусто, без блокировки читается только size заголовка — это
+// подсказка. Заголовок целиком перечитывается и take выполняется под
+// FileLock(fname.lock), как у писателей; если элементы успел забрать
+// другой потребитель, ждём дальше.
+template <class T>
+template <class Take>
+bool BinaryList<T>::waitTake(int timeoutMs, Take take) {
+    if (!is_open()) return false;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    FileLock lock(fname + ".lock");
+    while (true) {
+        unsigned long long seen = waitCh->seq();  // до проверки: запись после неё разбудит
+        if (diskSize() > 0) {
+            lock.lock();
+            refresh();
+            bool ok = fh.size > 0 && take();
+            flush();  // другой процесс должен увидеть запись после unlock
+            lock.unlock();
+            if (ok) return true;
+        }
+        int left = -1;
+        if (timeoutMs >= 0) {
+            left = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0) return false;
+        }
+        waitCh->wait(seen, left);
+    }
+}
+
+template <class T>
+bool BinaryList<T>::wait_nonempty(int timeoutMs) {
+    return waitTake(timeoutMs, [] { return true; });
+}
+
+template <class T>
+bool BinaryList<T>::pop_front_wait(T& out, int timeoutMs) {
+    return waitTake(timeoutMs, [&] { return pop_front(out); });
+}
+
+//-----------------------------------------------------
+// Хеш-индекс
+//-----------------------------------------------------
+template <class T>
+void BinaryList<T>::attachHashIndex() {
+    bool ok = hidx.attach(fname + ".hidx");
+    hidxOn = true;
+    if (!ok || hidx.storedGen() != fh.gen) {
+        // Индекса нет, он битый или список менялся без него
+        rebuildHashIndex();
+    }
+}
+
+template <class T>
+void BinaryList<T>::enableHashIndex() {
+    if (!is_open() || hidxOn) return;
+    attachHashIndex();
+}
+
+template <class T>
+void BinaryList<T>::disableHashIndex() {
+    if (!hidxOn) return;
+    hidx.close();
+    hidxOn = false;
+    std::remove((fname + ".hidx").c_str());
+}
+
+// Потоковый проход по списку: (хеш ключа, позиция) для каждого узла
+template <class T>
+void BinaryList<T>::rebuildHashIndex() {
+    std::vector<HashSlot> entries;
+    entries.reserve(fh.size);
+    int cur = fh.head;
+    for (int i = 0; i < fh.size; i++) {
+        int n = readNext(cur);
+        Codec::read(*this, scratch);
+        entries.push_back(HashSlot{KeyOf<T>::hash(KeyOf<T>::key(scratch)), cur});
+        cur = n;
+    }
+    hidx.rebuild(entries);
+}
+
+// Ключ добавлен/удалён: обновляем включённые индексы
+template <class T>
+void BinaryList<T>::idxAdd(const T& value, int pos) {
+    if (!hidxOn && !bloomOn) return;
+    unsigned h = KeyOf<T>::hash(KeyOf<T>::key(value));
+    if (hidxOn) hidx.add(h, pos);
+    if (bloomOn) bloom.add(h);
+}
+
+template <class T>
+void BinaryList<T>::idxRemoveAt(int pos) {
+    if (hidxOn) {
+        readValue(pos, scratch);
+        hidx.remove(KeyOf<T>::hash(KeyOf<T>::key(scratch)), pos);
+    }
+    if (bloomOn) {
+        bloom.noteRemoved();
+    }
+}
+
+//-----------------------------------------------------
+// Фильтр Блума
+//-----------------------------------------------------
+template <class T>
+void BinaryList<T>::enableBloomFilter() {
+    if (!is_open() || bloomOn) return;
+    bloomOn = true;
+    if (!bloom.load(fname + ".bloom") || bloom.storedGen() != fh.gen) {
+        rebuildBloom();
+    }
+}
+
+template <class T>
+void BinaryList<T>::disableBloomFilter() {
+    if (!bloomOn) return;
+    bloomOn = false;
+    std::remove((fname + ".bloom").c_str());
+}
+
+// Потоковый проход по списку; размер — с запасом вдвое на рост
+template <class T>
+void BinaryList<T>::rebuildBloom() {
+    bloom.reset(fh.size * 2);
+    int cur = fh.head;
+    for (int i = 0; i < fh.size; i++) {
+        int n = readNext(cur);
+        Codec::read(*this, scratch);
+        bloom.add(KeyOf<T>::hash(KeyOf<T>::key(scratch)));
+        cur = n;
+    }
+}
+
+// Фильтр Блума отсекает отсутствующие ключи в памяти.
+// С индексом — проверяются только узлы с совпавшим хешем,
+// без индекса — линейный проход по списку
+template <class T>
+bool BinaryList<T>::find(const Key& key, T& out) {
+    if (!is_open()) return false;
+    if (bloomOn) {
+        if (bloom.needsRebuild()) {
+            rebuildBloom();
+        }
+        if (!bloom.mayContain(KeyOf<T>::hash(key))) return false;
+    }
+    if (hidxOn) {
+        return hidx.lookup(KeyOf<T>::hash(key), [&](int pos) {
+            readValue(pos, out);
+            return KeyOf<T>::equal(KeyOf<T>::key(out), key);
+        });
+    }
+    int cur = fh.head;
+    for (int i = 0; i < fh.size; i++) {
+        int n = readNext(cur);
+        Codec::read(*this, scratch);
+        if (KeyOf<T>::equal(KeyOf<T>::key(scratch), key)) {
+            out = scratch;
+            return true;
+        }
+        cur = n;
+    }
+    return false;
+}
+
+template <class T>
+bool BinaryList<T>::contains(const Key& key) {
+    T tmp{};
+    return find(key, tmp);
+}
+
+//-----------------------------------------------------
+// Асинхронный ввод-вывод
+//-----------------------------------------------------
+template <class T>
+void BinaryList<T>::enableAsyncIO() {
+    if (!is_open()) return;
+    asyncOn = true;
+}
+
+template <class T>
+void BinaryList<T>::disableAsyncIO() {
+    dropReadAhead();
+    asyncOn = false;
+    io.close();
+}
+
+// Движок открывается лениво; буфер потока сбрасываем, чтобы
+// движок видел всё, что записано через fstream
+template <class T>
+bool BinaryList<T>::ioReady() {
+    if (!is_open()) return false;
+    flush();
+    if (!io.isOpen()) io.open(path);
+    return io.isOpen();
+}
+
+// Данные узлов по известным позициям — одним пакетом. Узлы читаются
+// целиком, чтобы лежащие подряд склеились в одно большое чтение;
+// для строк сначала пакет заголовков (длины), потом пакет узлов.
+template <class T>
+bool BinaryList<T>::readPayloads(const std::vector<int>& pos, T* out) {
+    if (pos.empty()) return true;
+    if (!ioReady()) return false;
+    std::vector<IoRequest> batch(pos.size());
+    std::vector<char> buf;
+    std::vector<int> offs(pos.size() + 1, 0);
+    if constexpr (Codec::fixedSize) {
+        // Шаг раскладки — узел с CRC, округлённый до слота. Хвост
+        // выравнивания читаем, только если следующий слот тоже есть
+        // в пакете: тогда запросы идут встык, а за конец файла не выйдем
+        const int ns = NODE_SIZE + crcBytes();
+        std::vector<int> sorted;
+        if (fh.align > 1) {
+            sorted = pos;
+            std::sort(sorted.begin(), sorted.end());
+        }
+        for (size_t i = 0; i < pos.size(); i++) {
+            int len = ns;
+            int next = slotFor(pos[i] + ns, ns);
+            if (next != pos[i] + ns && std::binary_search(sorted.begin(), sorted.end(), next)) {
+                len = next - pos[i];
+            }
+            offs[i + 1] = offs[i] + len;
+        }
+    }
+    else {
+        const int HEAD = LINKS + (int)sizeof(int);
+        buf.resize(pos.size() * HEAD);
+        for (size_t i = 0; i < pos.size(); i++) {
+            batch[i] = IoRequest{ pos[i], HEAD, &buf[i * HEAD] };
+        }
+        if (!io.readBatch(batch)) return false;
+        for (size_t i = 0; i < pos.size(); i++) {
+            int len;
+            std::memcpy(&len, &buf[i * HEAD + LINKS], sizeof(int));
+            if (len < 0 || len > 1000000) return false;  // тот же safeguard, что в NodeCodec
+            offs[i + 1] = offs[i] + HEAD + len;
+        }
+    }
+    buf.resize(offs[pos.size()]);
+    for (size_t i = 0; i < pos.size(); i++) {
+        batch[i] = IoRequest{ pos[i], offs[i + 1] - offs[i], &buf[offs[i]] };
+    }
+    if (!io.readBatch(batch)) return false;
+    for (size_t i = 0; i < pos.size(); i++) {
+        Codec::decode(&buf[offs[i] + LINKS], out[i]);
+    }
+    return true;
+}
+
+// Правки ссылок двух соседей независимы — отдаём их движку одним
+// пакетом; без движка (или при ошибке) пишем по очереди
+template <class T>
+void BinaryList<T>::patchLinks(int p, int pNext, int n, int nPrev) {
+    if (asyncOn && p != -1 && n != -1 && ioReady()) {
+        beforeWrite(p + (int)sizeof(int), (int)sizeof(int));
+        beforeWrite(n, (int)sizeof(int));
+        std::vector<IoRequest> batch = {
+            IoRequest{ p + (int)sizeof(int), (int)sizeof(int), reinterpret_cast<char*>(&pNext) },
+            IoRequest{ n, (int)sizeof(int), reinterpret_cast<char*>(&nPrev) }
+        };
+        if (io.writeBatch(batch)) return;
+    }
+    if (p != -1) writeNext(p, pNext);
+    if (n != -1) writePrev(n, nPrev);
+}
+
+// Обход всего списка окнами: позиции окна берутся арифметикой,
+// из позиционного индекса или проходом по ссылкам, а данные
+// окна читаются одним пакетом
+template <class T>
+template <class Visit>
+void BinaryList<T>::scanAhead(Visit visit) {
+    const int WINDOW = 1024;
+    bool known = (Codec::fixedSize && (fh.flags & HF_CONTIGUOUS)) || posValid;
+    std::vector<int> pos;
+    std::vector<T> vals(std::min(WINDOW, fh.size));
+    int cur = fh.head;
+    for (int i = 0; i < fh.size; ) {
+        int cnt = std::min(WINDOW, fh.size - i);
+        pos.resize(cnt);
+        for (int j = 0; j < cnt; j++) {
+            if (known) {
+                pos[j] = nodeAt(i + j);
+            }
+            else {
+                pos[j] = cur;
+                cur = readNext(cur);
+            }
+        }
+        if (!readPayloads(pos, vals.data())) {
+            for (int j = 0; j < cnt; j++) readValue(pos[j], vals[j]);
+        }
+        for (int j = 0; j < cnt; j++) visit(vals[j]);
+        i += cnt;
+    }
+}
+
+// Упреждающее чтение итератора: следующее окно узлов одним пакетом
+template <class T>
+void BinaryList<T>::fillAhead() {
+    const int WINDOW = 256;
+    std::vector<int> pos;
+    while (iterPos != -1 && (int)pos.size() < WINDOW) {
+        pos.push_back(iterPos);
+        iterPos = readNext(iterPos);
+    }
+    std::vector<T> vals(pos.size());
+    if (!readPayloads(pos, vals.data())) {
+        for (size_t j = 0; j < pos.size(); j++) readValue(pos[j], vals[j]);
+    }
+    for (size_t j = 0; j < pos.size(); j++) {
+        ahead.push_back(std::move(vals[j]));
+        aheadPos.push_back(pos[j]);
+    }
+}
+
+// Список изменился: итератор продолжит с первого невыданного узла
+template <class T>
+void BinaryList<T>::dropReadAhead() {
+    if (!aheadPos.empty()) {
+        iterPos = aheadPos.front();
+    }
+    ahead.clear();
+    aheadPos.clear();
+}
+
+template <class T>
+void BinaryList<T>::getMany(const std::vector<int>& indices, std::vector<T>& out) {
+    out.clear();
+    if (!is_open()) return;
+    for (int idx : indices) {
+        if (idx < 0 || idx >= fh.size) {
+            std::cout << "[" << Codec::tag() << "] Неверный индекс getMany: " << idx << "\n";
+            return;
+        }
+    }
+    if (!(Codec::fixedSize && (fh.flags & HF_CONTIGUOUS)) && !posValid) {
+        buildPosIndex();
+    }
+    std::vector<int> pos(indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+        pos[i] = nodeAt(indices[i]);
+    }
+    out.resize(indices.size());
+    if (!readPayloads(pos, out.data())) {
+        for (size_t i = 0; i < pos.size(); i++) readValue(pos[i], out[i]);
+    }
+}
+
+//-----------------------------------------------------
+// Параллельные обходы
+//-----------------------------------------------------
+
+// Разбить список на диапазоны и обойти их на пуле потоков.
+// visit(w, value) получает номер диапазона w
+template <class T>
+template <class Visit>
+void BinaryList<T>::scanParallel(Visit visit) {
+    std::vector<T> vals(WorkerPool::shared().size());  // свой буфер значения у диапазона
+    scanNodesParallel([&](int w, int, int, const char* data) {
+        Codec::decode(data, vals[w]);
+        visit(w, vals[w]);
+    });
+}
+
+// visit(w, index, pos, data) — данные узла без декодирования. Начала
+// диапазонов: при узлах «подряд» — по формуле, иначе один проход по
+// полям next (без чтения данных), дальше каждый поток идёт по своей
+// цепочке через своё окно файла.
+template <class T>
+template <class Visit>
+void BinaryList<T>::scanNodesParallel(Visit visit) {
+    if (!is_open() || fh.size == 0) return;
+    flush();  // потоки читают файл через свои дескрипторы
+    seekg(0, std::ios::end);
+    int fileEnd = (int)tellg();
+
+    const int MIN_RANGE = 1024;  // мельче дробить нет смысла
+    WorkerPool& pool = WorkerPool::shared();
+    int parts = std::min(pool.size(), (fh.size + MIN_RANGE - 1) / MIN_RANGE);
+    std::vector<int> from(parts), first(parts), count(parts);
+    for (int k = 0; k < parts; k++) {
+        from[k] = (int)((long long)fh.size * k / parts);
+        int to = (int)((long long)fh.size * (k + 1) / parts);
+        count[k] = to - from[k];
+    }
+    bool contiguous = Codec::fixedSize && (fh.flags & HF_CONTIGUOUS);
+    if (!contiguous) {
+        int cur = fh.head;
+        int k = 0;
+        for (int i = 0; i < fh.size && k < parts; i++) {
+            if (i == from[k]) {
+                first[k++] = cur;
+            }
+            if (k < parts) cur = readNext(cur);
+        }
+    }
+
+    std::string name = path;
+    pool.run(parts, [&](int k) {
+        std::ifstream in(name.c_str(), std::ios::binary);
+        if constexpr (Codec::fixedSize) {
+            if (contiguous) {
+                // Узлы подряд: читаем большими блоками без переходов по ссылкам
+                // (позиции — по формуле)
+                const int BATCH = 4096;
+                std::vector<char> buf;
+                for (int done = 0; done < count[k]; ) {
+                    int n = std::min(BATCH, count[k] - done);
+                    int a = from[k] + done;
+                    int start = contiguousPos(a);
+                    buf.resize(contiguousPos(a + n - 1) + NODE_SIZE + crcBytes() - start);
+                    in.seekg(start, std::ios::beg);
+                    in.read(buf.data(), (std::streamsize)buf.size());
+                    for (int j = 0; j < n; j++) {
+                        int pos = contiguousPos(a + j);
+                        visit(k, a + j, pos, &buf[pos - start + LINKS]);
+                    }
+                    done += n;
+                }
+                return;
+            }
+        }
+        FileWindow win(in, fileEnd);
+        int pos = first[k];
+        int prevEnd = pos;
+        for (int j = 0; j < count[k]; j++) {
+            bool seq = pos >= prevEnd && pos - prevEnd < FileWindow::SMALL;
+            int links[2], len;
+            const char* data;
+            if (!peekNode(win, pos, seq, links, len, data)) break;
+            visit(k, from[k] + j, pos, data);
+            prevEnd = pos + len;
+            pos = links[1];
+        }
+    });
+}
+
+template <class T>
+template <class F>
+void BinaryList<T>::for_each(F f) {
+    scanParallel([&](int, const T& v) { f(v); });
+}
+
+template <class T>
+template <class Pred>
+int BinaryList<T>::count_if(Pred pred) {
+    return transform_reduce(0, [](int a, int b) { return a + b; },
+        [&](const T& v) { return pred(v) ? 1 : 0; });
+}
+
+// op должна быть ассоциативной: частичные результаты диапазонов
+// сворачиваются в порядке диапазонов, начиная с init
+template <class T>
+template <class Op>
+T BinaryList<T>::reduce(T init, Op op) {
+    return transform_reduce(init, op, [](const T& v) { return v; });
+}
+
+template <class T>
+template <class R, class ReduceOp, class Map>
+R BinaryList<T>::transform_reduce(R init, ReduceOp reduceOp, Map map) {
+    std::vector<std::optional<R>> partial(WorkerPool::shared().size());
+    scanParallel([&](int w, const T& v) {
+        if (partial[w]) partial[w] = reduceOp(*partial[w], map(v));
+        else partial[w] = map(v);
+    });
+    R res = init;
+    for (auto& p : partial) {
+        if (p) res = reduceOp(res, *p);
+    }
+    return res;
+}
+
+// Новые ссылки узлов — по возрастанию позиций: узлы, лежащие рядом,
+// правятся одним чтением и одной записью блока, одиночный узел —
+// записью 8 байт ссылок
+template <class T>
+void BinaryList<T>::writePatches(std::vector<LinkPatch>& patches) {
+    std::sort(patches.begin(), patches.end(),
+              [](const LinkPatch& a, const LinkPatch& b) { return a.pos < b.pos; });
+    flush();
+    std::vector<char> buf;
+    int n = (int)patches.size();
+    for (int a = 0; a < n; ) {
+        int b = a + 1;
+        while (b < n && patches[b].pos - patches[b - 1].pos < FileWindow::SMALL
+               && patches[b].pos + LINKS - patches[a].pos <= FileWindow::BIG) {
+            b++;
+        }
+        int start = patches[a].pos;
+        buf.resize(patches[b - 1].pos + LINKS - start);
+        if (b - a > 1) {
+            seekg(start, std::ios::beg);
+            read(buf.data(), (std::streamsize)buf.size());
+        }
+        for (int i = a; i < b; i++) {
+            // снимки хранят прежние байты по полям: prev, next, данные
+            beforeWrite(patches[i].pos, (int)sizeof(int));
+            beforeWrite(patches[i].pos + (int)sizeof(int), (int)sizeof(int));
+            std::memcpy(&buf[patches[i].pos - start], patches[i].links, LINKS);
+        }
+        seekp(start, std::ios::beg);
+        write(buf.data(), (std::streamsize)buf.size());
+        a = b;
+    }
+}
+
+//-----------------------------------------------------
+// Проекция полей (типы фиксированного размера)
+//-----------------------------------------------------
+
+// Данные узла — байты T как есть (NodeCodec по умолчанию), поэтому
+// поле лежит по тому же смещению, что и в объекте
+template <class T>
+template <class M, class C>
+int BinaryList<T>::fieldOffset(M C::*field) {
+    static const T probe{};
+    return (int)(reinterpret_cast<const char*>(&(probe.*field))
+               - reinterpret_cast<const char*>(&probe));
+}
+
+template <class T>
+template <class M, class C>
+M BinaryList<T>::read_field(int index, M C::*field) {
+    static_assert(std::is_same<C, T>::value && Codec::fixedSize
+                  && std::is_trivially_copyable<M>::value && !std::is_array<M>::value,
+                  "read_field: тип фиксированного размера и поле-скаляр");
+    M res{};
+    if (!is_open()) return res;
+    if (index < 0 || index >= fh.size) {
+        std::cout << "[" << Codec::tag() << "] Неверный индекс read_field: " << index << "\n";
+        return res;
+    }
+    seekg(nodeAt(index) + LINKS + fieldOffset(field), std::ios::beg);
+    read(reinterpret_cast<char*>(&res), sizeof(M));
+    return res;
+}
+
+template <class T>
+template <class M, class C>
+void BinaryList<T>::read_field(M C::*field, std::vector<M>& out) {
+    static_assert(std::is_same<C, T>::value && Codec::fixedSize
+                  && std::is_trivially_copyable<M>::value && !std::is_array<M>::value,
+                  "read_field: тип фиксированного размера и поле-скаляр");
+    out.assign(fh.size, M{});
+    int off = fieldOffset(field);
+    scanNodesParallel([&](int, int i, int, const char* data) {
+        std::memcpy(&out[i], data + off, sizeof(M));
+    });
+}
+
+template <class T>
+template <class M, class C, class Pred>
+int BinaryList<T>::count_if(M C::*field, Pred pred) {
+    static_assert(std::is_same<C, T>::value && Codec::fixedSize
+                  && std::is_trivially_copyable<M>::value && !std::is_array<M>::value,
+                  "count_if(поле): тип фиксированного размера и поле-скаляр");
+    std::vector<int> partial(WorkerPool::shared().size(), 0);
+    int off = fieldOffset(field);
+    scanNodesParallel([&](int w, int, int, const char* data) {
+        M v;
+        std::memcpy(&v, data + off, sizeof(M));
+        if (pred(v)) partial[w]++;
+    });
+    int res = 0;
+    for (int p : partial) res += p;
+    return res;
+}
+
+// Диапазоны идут по порядку списка, поэтому склеенные в порядке
+// диапазонов индексы уже отсортированы
+template <class T>
+template <class M, class C, class Pred>
+std::vector<int> BinaryList<T>::find_all(M C::*field, Pred pred) {
+    static_assert(std::is_same<C, T>::value && Codec::fixedSize
+                  && std::is_trivially_copyable<M>::value && !std::is_array<M>::value,
+                  "find_all: тип фиксированного размера и поле-скаляр");
+    std::vector<std::vector<int>> partial(WorkerPool::shared().size());
+    int off = fieldOffset(field);
+    scanNodesParallel([&](int w, int i, int, const char* data) {
+        M v;
+        std::memcpy(&v, data + off, sizeof(M));
+        if (pred(v)) partial[w].push_back(i);
+    });
+    std::vector<int> res;
+    for (auto& p : partial) res.insert(res.end(), p.begin(), p.end());
+    return res;
+}
+
+// В памяти — только пары (поле, позиция узла); после сортировки
+// переписываются ссылки, данные узлов остаются на месте
+template <class T>
+template <class M, class C>
+void BinaryList<T>::sort_by(M C::*field) {
+    static_assert(std::is_same<C, T>::value && Codec::fixedSize
+                  && std::is_trivially_copyable<M>::value && !std::is_array<M>::value,
+                  "sort_by: тип фиксированного размера и поле-скаляр");
+    if (!is_open() || fh.size <= 1) return;
+    struct Key { M key; int idx; int pos; };
+    std::vector<Key> keys(fh.size);
+    int off = fieldOffset(field);
+    scanNodesParallel([&](int, int i, int pos, const char* data) {
+        std::memcpy(&keys[i].key, data + off, sizeof(M));
+        keys[i].idx = i;
+        keys[i].pos = pos;
+    });
+    // Номер элемента при равных полях делает сортировку устойчивой
+    parallelSort(keys.begin(), keys.end(), [](const Key& a, const Key& b) {
+        if (a.key < b.key) return true;
+        if (b.key < a.key) return false;
+        return a.idx < b.idx;
+    });
+    std::vector<int> order(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) order[i] = keys[i].pos;
+    relink(order);
+}
+
+// Связать узлы в порядке order (позиции)
+template <class T>
+void BinaryList<T>::relink(const std::vector<int>& order) {
+    int n = (int)order.size();
+    std::vector<LinkPatch> patches(n);
+    for (int i = 0; i < n; i++) {
+        patches[i] = LinkPatch{ order[i], { i > 0 ? order[i - 1] : -1, i + 1 < n ? order[i + 1] : -1 } };
+    }
+    writePatches(patches);
+    fh.head = order.front();
+    fh.tail = order.back();
+    fh.flags &= ~HF_SORTED;
+    if (!std::is_sorted(order.begin(), order.end())) {
+        fh.flags &= ~HF_CONTIGUOUS;  // порядок списка разошёлся с порядком в файле
+    }
+    if (posValid) {
+        posIndex.assign(order.begin(), order.end());
+    }
+    iterPos = -1;
+    writeHeader();
+}
+
+//-----------------------------------------------------
+// Снимки (MVCC)
+//-----------------------------------------------------
+template <class T>
+std::unique_ptr<ListSnapshot<T>> BinaryList<T>::snapshot() {
+    if (!is_open()) return nullptr;
+    flush();  // у снимка свой дескриптор — он должен видеть всё записанное
+    seekg(0, std::ios::end);
+    int fileEnd = (int)tellg();
+    std::unique_ptr<ListSnapshot<T>> s(new ListSnapshot<T>(path, snaps, fh, fileEnd));
+    std::lock_guard<std::mutex> lk(snaps->m);
+    snaps->pinned.push_back(&s->st);
+    snaps->count++;
+    return s;
+}
+
+template <class T>
+bool BinaryList<T>::snapshot_to(const std::string& path) {
+    if (!is_open() || path == fname || path == this->path) return false;
+    std::string tmp = path + ".tmp";
+    auto t0 = std::chrono::steady_clock::now();
+    CloneMethod m;
+    if (space) {
+        // Клон файла контейнера унёс бы все его списки, поэтому узлы
+        // переписываются в отдельный файл одним проходом (как в compact)
+        std::remove(tmp.c_str());
+        {
+            BinaryList<T> out(tmp);
+            adoptLayout(out);
+            int cur = fh.head;
+            int left = fh.size;
+            out.appendBulk([&](T& v) {
+                if (left == 0) return false;
+                int n = readNext(cur);
+                Codec::read(*this, v);
+                cur = n;
+                left--;
+                return true;
+            });
+            out.fh.flags |= fh.flags & HF_SORTED;
+            out.writeHeader();
+            m = out.good() ? CM_STREAM : CM_FAILED;
+        }
+    }
+    else {
+        FileLock lk(fname + ".lock");
+        lk.lock();
+        flush();
+        m = cloneFile(fname, tmp);
+        lk.unlock();
+    }
+    if (m == CM_FAILED) {
+        std::remove(tmp.c_str());
+        std::cout << "[" << Codec::tag() << "] Не удалось скопировать " << fname << " в " << path << "\n";
+        return false;
+    }
+    // Спутники старой копии с тем же именем к новой не относятся
+    std::remove((path + ".hidx").c_str());
+    std::remove((path + ".bloom").c_str());
+    std::remove(path.c_str());
+    std::rename(tmp.c_str(), path.c_str());
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "[" << Codec::tag() << "] Копия " << path << ": " << cloneMethodName(m)
+              << ", " << ms << " мс\n";
+    return true;
+}
+
+template <class T>
+std::unique_ptr<BinaryList<T>> BinaryList<T>::open_clone(const std::string& path) {
+    if (!snapshot_to(path)) return nullptr;
+    return std::unique_ptr<BinaryList<T>>(new BinaryList<T>(path));
+}
+
+// Прежние байты сохраняются один раз на снимок: дальнейшие
+// перезаписи того же места снимку уже не важны
+template <class T>
+void BinaryList<T>::beforeWrite(int pos, int len) {
+    if (snaps->count.load() == 0) return;
+    std::lock_guard<std::mutex> lk(snaps->m);
+    std::string old;
+    for (SnapshotState<T>* st : snaps->pinned) {
+        if (st->detached || pos >= st->fileEnd || st->before.count(pos)) continue;
+        if (old.empty()) {
+            old.resize(len);
+            seekg(pos, std::ios::beg);
+            read(&old[0], len);
+        }
+        st->before.emplace(pos, old);
+    }
+}
+
+// Файл заменяется целиком (clear, sort строк, merge, rewriteAll).
+// На POSIX дескриптор снимка держит старый файл, и снимок просто
+// отвязывается; без этого значения снимка копируются в память.
+template <class T>
+void BinaryList<T>::detachSnapshots() {
+    if (snaps->count.load() == 0) return;
+    std::lock_guard<std::mutex> lk(snaps->m);
+    for (SnapshotState<T>* st : snaps->pinned) {
+        if (st->detached) continue;
+#if !BL_HAVE_PREAD
+        st->frozen.clear();
+        st->frozen.reserve(st->fh.size);
+        int cur = st->fh.head;
+        for (int i = 0; i < st->fh.size; i++) {
+            char links[LINKS];
+            seekg(cur, std::ios::beg);
+            read(links, LINKS);
+            snapshotPatch(*st, cur, links, LINKS);
+            T val{};
+            if constexpr (Codec::fixedSize) {
+                char buf[Codec::size];
+                read(buf, Codec::size);
+                snapshotPatch(*st, cur + LINKS, buf, Codec::size);
+                Codec::decode(buf, val);
+            }
+            else {
+                Codec::read(*this, val);
+            }
+            st->frozen.push_back(std::move(val));
+            std::memcpy(&cur, links + sizeof(int), sizeof(int));
+        }
+        st->frozenOn = true;
+        st->before.clear();
+#endif
+        st->detached = true;
+    }
+}
+
+//--------------------------------------------------------------
+// 2) Снимок списка ListSnapshot<T>
+//    Читает версию списка на момент snapshot() через свой
+//    дескриптор, накладывая прежние байты из before-карты.
+//    Можно читать из другого потока, пока в список пишут.
+//--------------------------------------------------------------
+template <class T>
+class ListSnapshot {
+public:
+    ~ListSnapshot();  // снимает закрепление
+
+    int  getSize() const;
+    void initIterator();
+    bool hasNext() const;
+    T    next();
+    void print();
+    template <class F> void for_each(F f);
+
+private:
+    friend class BinaryList<T>;
+    typedef NodeCodec<T> Codec;
+    static constexpr int LINKS = 2 * (int)sizeof(int);
+
+    ListSnapshot(const std::string& filename, std::shared_ptr<SnapshotHub<T>> hub,
+                 const FileHeader& fh, int fileEnd);
+    bool readNode(int pos, int idx, int& next, T& val);
+
+    std::shared_ptr<SnapshotHub<T>> hub;
+    SnapshotState<T> st;
+    std::ifstream in;
+    int iterPos;
+    int iterIdx;
+};
+
+template <class T>
+ListSnapshot<T>::ListSnapshot(const std::string& filename, std::shared_ptr<SnapshotHub<T>> h,
+                              const FileHeader& fh, int fileEnd)
+    : hub(std::move(h)), in(filename.c_str(), std::ios::binary), iterPos(-1), iterIdx(0)
+{
+    st.fh = fh;
+    st.fileEnd = fileEnd;
+    st.detached = false;
+    st.frozenOn = false;
+    initIterator();
+}
+
+template <class T>
+ListSnapshot<T>::~ListSnapshot() {
+    std::lock_guard<std::mutex> lk(hub->m);
+    auto& v = hub->pinned;
+    v.erase(std::remove(v.begin(), v.end(), &st), v.end());
+    hub->count--;
+}
+
+template <class T>
+int ListSnapshot<T>::getSize() const {
+    return st.fh.size;
+}
+
+// Сначала читаем файл, потом под замком смотрим before-карту:
+// список сохраняет прежние байты до записи, поэтому что бы ни
+// попало в прочитанное, наложение вернёт версию снимка
+template <class T>
+bool ListSnapshot<T>::readNode(int pos, int idx, int& next, T& val) {
+    char links[LINKS];
+    char buf[Codec::fixedSize ? Codec::size : 1];
+    in.seekg(pos, std::ios::beg);
+    in.read(links, LINKS);
+    if constexpr (Codec::fixedSize) {
+        in.read(buf, Codec::size);
+    }
+    else {
+        Codec::read(in, val);  // строки на месте не переписываются
+    }
+    bool ok = (bool)in;
+    in.clear();
+    {
+        std::lock_guard<std::mutex> lk(hub->m);
+        if (st.frozenOn) {
+            val = st.frozen[idx];
+            next = -1;
+            return true;
+        }
+        snapshotPatch(st, pos, links, LINKS);
+        if constexpr (Codec::fixedSize) {
+            snapshotPatch(st, pos + LINKS, buf, Codec::size);
+        }
+    }
+    if constexpr (Codec::fixedSize) {
+        Codec::decode(buf, val);
+    }
+    std::memcpy(&next, links + sizeof(int), sizeof(int));
+    return ok;
+}
+
+template <class T>
+void ListSnapshot<T>::initIterator() {
+    iterPos = st.fh.head;
+    iterIdx = 0;
+}
+
+template <class T>
+bool ListSnapshot<T>::hasNext() const {
+    return iterIdx < st.fh.size;
+}
+
+template <class T>
+T ListSnapshot<T>::next() {
+    T res{};
+    if (!hasNext()) return res;
+    int n;
+    readNode(iterPos, iterIdx, n, res);
+    iterPos = n;
+    iterIdx++;
+    return res;
+}
+
+template <class T>
+template <class F>
+void ListSnapshot<T>::for_each(F f) {
+    int cur = st.fh.head;
+    T val{};
+    for (int i = 0; i < st.fh.size; i++) {
+        int n;
+        readNode(cur, i, n, val);
+        f(val);
+        cur = n;
+    }
+}
+
+template <class T>
+void ListSnapshot<T>::print() {
+    std::cout << "[" << Codec::tag() << "] Снимок (size=" << st.fh.size << "):\n";
+    int i = 0;
+    for_each([&](const T& v) {
+        std::cout << "  [" << i++ << "]: " << Codec::view(v) << "\n";
+    });
+}
+
+//--------------------------------------------------------------
+// 3) Сегментированный список SegmentedList<T>
+//    Список разбит на пронумерованные файлы-сегменты:
+//      fname        — манифест (SegmentManifest)
+//      fname.<N>    — сегмент N, обычный файл BinaryList<T>
+//    push_back пишет в активный (последний) сегмент, а сегмент,
+//    опустошённый pop_front, удаляется с диска. Так бесконечная
+//    очередь занимает ограниченное место, а clear() — O(сегментов).
+//--------------------------------------------------------------
+struct SegmentManifest {
+    int firstSeg;     // номер самого старого сегмента
+    int lastSeg;      // номер активного сегмента (сюда идёт push_back)
+    int segCapacity;  // сколько элементов push_back кладёт в один сегмент
+};
+
+template <class T>
+class SegmentedList {
+private:
+    SegmentManifest sm;
+    std::string fname;             // имя файла-манифеста
+    std::deque<int> segSizes;      // размеры сегментов firstSeg..lastSeg
+    int total;                     // общее число элементов
+
+    // Открытые сегменты: активный, головной (если он не совпадает
+    // с активным) и один «промежуточный» для доступа по индексу.
+    std::unique_ptr<BinaryList<T>> tailSeg;
+    std::unique_ptr<BinaryList<T>> headSeg;
+    std::unique_ptr<BinaryList<T>> midSeg;
+    int midNum;
+
+    int iterSeg;                   // сегмент итератора (или -1)
+
+public:
+    SegmentedList(const std::string& filename, int segCapacity = 4096);
+
+    void push_back(const T& value);
+    void insert(int index, const T& value);
+    void erase(int index);
+    T    get(int index);
+    void update(int index, const T& value);
+    void pop_back();
+    void pop_front();
+    int  pop_front_n(int n, T* out = nullptr);  // снять до n голов, вернуть сколько
+    void clear();
+    void print();
+    int  getSize() const;
+    int  getSegmentCount() const;
+
+    // Перенести все сегменты other в конец этого списка (other опустеет).
+    // Файлы-сегменты только переименовываются — O(сегментов), без копирования.
+    void splice(SegmentedList<T>& other);
+
+    // Итератор (проходит сегменты по порядку)
+    void initIterator();
+    bool hasNext();
+    T    next();
+
+private:
+    std::string segName(int n) const;
+    void writeManifest();
+    BinaryList<T>& seg(int n);
+    void locate(int index, int& n, int& local) const;
+    void startNewSegment();
+    void dropDrainedFront();
+    void dropEmptyBack();
+};
+
+template <class T>
+SegmentedList<T>::SegmentedList(const std::string& filename, int segCapacity)
+    : fname(filename), total(0), midNum(-1), iterSeg(-1)
+{
+    std::ifstream mf(fname.c_str(), std::ios::binary);
+    if (mf.read(reinterpret_cast<char*>(&sm), sizeof(SegmentManifest))
+        && sm.firstSeg >= 0 && sm.firstSeg <= sm.lastSeg && sm.segCapacity > 0) {
+        mf.close();
+    }
+    else {
+        // Манифеста нет (или он битый) — начинаем с сегмента 0
+        mf.close();
+        sm.firstSeg = 0;
+        sm.lastSeg = 0;
+        sm.segCapacity = (segCapacity > 0) ? segCapacity : 4096;
+        writeManifest();
+    }
+
+    // Размеры сегментов читаем из их заголовков (O(сегментов))
+    for (int n = sm.firstSeg; n < sm.lastSeg; n++) {
+        BinaryList<T> s(segName(n));
+        segSizes.push_back(s.getSize());
+        total += s.getSize();
+    }
+    tailSeg.reset(new BinaryList<T>(segName(sm.lastSeg)));
+    segSizes.push_back(tailSeg->getSize());
+    total += tailSeg->getSize();
+    if (sm.firstSeg != sm.lastSeg) {
+        headSeg.reset(new BinaryList<T>(segName(sm.firstSeg)));
+    }
+}
+
+template <class T>
+std::string SegmentedList<T>::segName(int n) const {
+    return fname + "." + std::to_string(n);
+}
+
+template <class T>
+void SegmentedList<T>::writeManifest() {
+    std::ofstream mf(fname.c_str(), std::ios::binary | std::ios::trunc);
+    mf.write(reinterpret_cast<const char*>(&sm), sizeof(SegmentManifest));
+}
+
+// Доступ к сегменту по номеру: один файл никогда не открывается дважды,
+// иначе заголовки в памяти у двух BinaryList разошлись бы.
+template <class T>
+BinaryList<T>& SegmentedList<T>::seg(int n) {
+    if (n == sm.lastSeg) return *tailSeg;
+    if (n == sm.firstSeg) return *headSeg;
+    if (n != midNum) {
+        midSeg.reset(new BinaryList<T>(segName(n)));
+        midNum = n;
+    }
+    return *midSeg;
+}
+
+// Глобальный индекс -> (номер сегмента, индекс внутри сегмента)
+template <class T>
+void SegmentedList<T>::locate(int index, int& n, int& local) const {
+    n = sm.firstSeg;
+    local = index;
+    for (size_t k = 0; k < segSizes.size(); k++) {
+        if (local < segSizes[k] || k + 1 == segSizes.size()) {
+            n = sm.firstSeg + (int)k;
+            return;
+        }
+        local -= segSizes[k];
+    }
+}
+
+// Активный сегмент заполнен — открываем следующий
+template <class T>
+void SegmentedList<T>::startNewSegment() {
+    if (sm.lastSeg == sm.firstSeg) {
+        headSeg = std::move(tailSeg);  // бывший активный стал головным
+    }
+    else {
+        tailSeg.reset();
+    }
+    sm.lastSeg++;
+    tailSeg.reset(new BinaryList<T>(segName(sm.lastSeg)));
+    segSizes.push_back(0);
+    writeManifest();
+}
+
+// Удаляем опустошённые сегменты с головы (активный не трогаем).
+// Сначала фиксируем манифест, потом удаляем файл: при сбое
+// между этими шагами остаётся лишь «осиротевший» файл.
+template <class T>
+void SegmentedList<T>::dropDrainedFront() {
+    while (sm.firstSeg < sm.lastSeg && segSizes.front() == 0) {
+        int old = sm.firstSeg;
+        headSeg.reset();
+        if (midNum == old) {
+            midSeg.reset();
+            midNum = -1;
+        }
+        sm.firstSeg++;
+        segSizes.pop_front();
+        writeManifest();
+        std::remove(segName(old).c_str());
+
+        if (sm.firstSeg != sm.lastSeg) {
+            if (midNum == sm.firstSeg) {
+                headSeg = std::move(midSeg);
+                midNum = -1;
+            }
+            else {
+                headSeg.reset(new BinaryList<T>(segName(sm.firstSeg)));
+            }
+        }
+    }
+}
+
+// Пустой активный сегмент (после pop_back/erase) отдаём назад,
+// чтобы активным снова стал предыдущий.
+template <class T>
+void SegmentedList<T>::dropEmptyBack() {
+    while (sm.lastSeg > sm.firstSeg && segSizes.back() == 0) {
+        int old = sm.lastSeg;
+        tailSeg.reset();
+        sm.lastSeg--;
+        segSizes.pop_back();
+        writeManifest();
+        std::remove(segName(old).c_str());
+
+        if (sm.lastSeg == sm.firstSeg) {
+            tailSeg = std::move(headSeg);
+        }
+        else if (midNum == sm.lastSeg) {
+            tailSeg = std::move(midSeg);
+            midNum = -1;
+        }
+        else {
+            tailSeg.reset(new BinaryList<T>(segName(sm.lastSeg)));
+        }
+    }
+}
+
+template <class T>
+void SegmentedList<T>::push_back(const T& value) {
+    if (segSizes.back() >= sm.segCapacity) {
+        startNewSegment();
+    }
+    tailSeg->push_back(value);
+    segSizes.back()++;
+    total++;
+}
+
+template <class T>
+void SegmentedList<T>::insert(int index, const T& value) {
+    if (index < 0 || index > total) {
+        std::cout << "[seg] Неверный индекс insert: " << index << "\n";
+        return;
+    }
+    if (index == total) {
+        push_back(value);
+        return;
+    }
+    int n, local;
+    locate(index, n, local);
+    seg(n).insert(local, value);
+    segSizes[n - sm.firstSeg]++;
+    total++;
+}
+
+template <class T>
+void SegmentedList<T>::erase(int index) {
+    if (index < 0 || index >= total) {
+        std::cout << "[seg] Неверный индекс erase: " << index << "\n";
+        return;
+    }
+    int n, local;
+    locate(index, n, local);
+    seg(n).erase(local);
+    segSizes[n - sm.firstSeg]--;
+    total--;
+    dropDrainedFront();
+    dropEmptyBack();
+}
+
+template <class T>
+T SegmentedList<T>::get(int index) {
+    if (index < 0 || index >= total) {
+        std::cout << "[seg] Неверный индекс get: " << index << "\n";
+        return T{};
+    }
+    int n, local;
+    locate(index, n, local);
+    return seg(n).get(local);
+}
+
+template <class T>
+void SegmentedList<T>::update(int index, const T& value) {
+    if (index < 0 || index >= total) {
+        std::cout << "[seg] Неверный индекс update: " << index << "\n";
+        return;
+    }
+    int n, local;
+    locate(index, n, local);
+    seg(n).update(local, value);
+}
+
+template <class T>
+void SegmentedList<T>::pop_back() {
+    if (total == 0) {
+        std::cout << "[seg] Список пуст (pop_back)\n";
+        return;
+    }
+    dropEmptyBack();
+    erase(total - 1);
+}
+
+template <class T>
+void SegmentedList<T>::pop_front() {
+    if (total == 0) {
+        std::cout << "[seg] Список пуст (pop_front)\n";
+        return;
+    }
+    dropDrainedFront();
+    erase(0);
+}
+
+// Снимаем с головного сегмента сколько есть одним вызовом,
+// опустевшие сегменты удаляются целиком
+template <class T>
+int SegmentedList<T>::pop_front_n(int n, T* out) {
+    int done = 0;
+    while (done < n && total > 0) {
+        dropDrainedFront();
+        int k = std::min(n - done, segSizes.front());
+        seg(sm.firstSeg).pop_front_n(k, out ? out + done : nullptr);
+        segSizes.front() -= k;
+        total -= k;
+        done += k;
+    }
+    dropDrainedFront();
+    return done;
+}
+
+// Очистка: удаляем все файлы-сегменты и начинаем нумерацию заново
+template <class T>
+void SegmentedList<T>::clear() {
+    tailSeg.reset();
+    headSeg.reset();
+    midSeg.reset();
+    midNum = -1;
+    iterSeg = -1;
+    for (int n = sm.firstSeg; n <= sm.lastSeg; n++) {
+        std::remove(segName(n).c_str());
+    }
+    sm.firstSeg = 0;
+    sm.lastSeg = 0;
+    writeManifest();
+    tailSeg.reset(new BinaryList<T>(segName(0)));
+    segSizes.clear();
+    segSizes.push_back(0);
+    total = 0;
+}
+
+template <class T>
+void SegmentedList<T>::splice(SegmentedList<T>& other) {
+    if (&other == this || other.fname == fname) {
+        std::cout << "[seg] splice: это тот же самый список\n";
+        return;
+    }
+    if (other.total == 0) return;
+
+    // Пустой активный сегмент нам больше не нужен
+    dropEmptyBack();
+    other.tailSeg.reset();
+    other.headSeg.reset();
+    other.midSeg.reset();
+    other.midNum = -1;
+    other.iterSeg = -1;
+
+    if (sm.lastSeg == sm.firstSeg) {
+        headSeg = std::move(tailSeg);
+    }
+    else {
+        tailSeg.reset();
+    }
+    if (total == 0) {
+        // Наш единственный сегмент пуст — его место займут чужие
+        headSeg.reset();
+        std::remove(segName(sm.firstSeg).c_str());
+        segSizes.clear();
+        sm.lastSeg = sm.firstSeg - 1;
+    }
+    for (int n = other.sm.firstSeg; n <= other.sm.lastSeg; n++) {
+        int sz = other.segSizes[n - other.sm.firstSeg];
+        if (sz == 0) {
+            std::remove(other.segName(n).c_str());
+            continue;
+        }
+        sm.lastSeg++;
+        std::remove(segName(sm.lastSeg).c_str());
+        std::rename(other.segName(n).c_str(), segName(sm.lastSeg).c_str());
+        segSizes.push_back(sz);
+        total += sz;
+    }
+    writeManifest();
+    if (sm.lastSeg == sm.firstSeg) {
+        headSeg.reset();
+    }
+    else if (!headSeg) {
+        headSeg.reset(new BinaryList<T>(segName(sm.firstSeg)));
+    }
+    tailSeg.reset(new BinaryList<T>(segName(sm.lastSeg)));
+
+    // other начинает с чистого сегмента 0
+    other.sm.firstSeg = 0;
+    other.sm.lastSeg = 0;
+    other.writeManifest();
+    other.tailSeg.reset(new BinaryList<T>(other.segName(0)));
+    other.segSizes.clear();
+    other.segSizes.push_back(0);
+    other.total = 0;
+}
+
+template <class T>
+void SegmentedList<T>::print() {
+    if (total == 0) {
+        std::cout << "[seg] Список пуст.\n";
+        return;
+    }
+    std::cout << "[seg] Содержимое (size=" << total
+              << ", сегментов=" << getSegmentCount() << "):\n";
+    int i = 0;
+    for (int n = sm.firstSeg; n <= sm.lastSeg; n++) {
+        BinaryList<T>& s = seg(n);
+        s.initIterator();
+        while (s.hasNext()) {
+            std::cout << "  [" << i++ << "]: " << s.nextView() << "\n";
+        }
+    }
+}
+
+template <class T>
+int SegmentedList<T>::getSize() const {
+    return total;
+}
+
+template <class T>
+int SegmentedList<T>::getSegmentCount() const {
+    return sm.lastSeg - sm.firstSeg + 1;
+}
+
+template <class T>
+void SegmentedList<T>::initIterator() {
+    iterSeg = sm.firstSeg;
+    seg(iterSeg).initIterator();
+}
+
+template <class T>
+bool SegmentedList<T>::hasNext() {
+    if (iterSeg == -1) return false;
+    while (!seg(iterSeg).hasNext()) {
+        if (iterSeg >= sm.lastSeg) {
+            iterSeg = -1;
+            return false;
+        }
+        iterSeg++;
+        seg(iterSeg).initIterator();
+    }
+    return true;
+}
+
+template <class T>
+T SegmentedList<T>::next() {
+    if (!hasNext()) return T{};
+    return seg(iterSeg).next();
+}
+
+#if BL_HAVE_COROUTINES
+//--------------------------------------------------------------
+// 4) Асинхронная обёртка AsyncBinaryList<T> (C++20, корутины)
+//    Операции выполняются на пуле WorkerPool::io() по одной за раз
+//    (список не потокобезопасен), а вызывающая корутина на это
+//    время приостанавливается и не держит поток цикла событий:
+//        co_await list.push_back(v);
+//        int x = co_await list.get(i);
+//        auto it = list.items();
+//        while (auto v = co_await it.next()) { ... }
+//--------------------------------------------------------------
+template <class T> class AsyncBinaryList;
+
+// Ожидаемая операция: op(list) выполняется в очереди списка
+template <class T, class R>
+struct ListOp {
+    AsyncBinaryList<T>* self;
+    std::function<R(BinaryList<T>&)> op;
+    std::conditional_t<std::is_void_v<R>, char, R> result{};
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        self->enqueue([this, h] {
+            if constexpr (std::is_void_v<R>) op(self->list);
+            else result = op(self->list);
+            self->resume(h);
+        });
+    }
+    R await_resume() {
+        if constexpr (!std::is_void_v<R>) return std::move(result);
+    }
+};
+
+// Асинхронный генератор: next() ожидается и даёт std::optional<T>,
+// пустой — когда элементы кончились
+template <class T>
+class AsyncGenerator {
+public:
+    struct promise_type;
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    struct promise_type {
+        std::optional<T> current;
+        std::coroutine_handle<> consumer;
+
+        // Отдаём управление тому, кто ждёт next()
+        struct ToConsumer {
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(Handle h) noexcept {
+                return h.promise().consumer;
+            }
+            void await_resume() const noexcept {}
+        };
+
+        AsyncGenerator get_return_object() { return AsyncGenerator(Handle::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        ToConsumer final_suspend() noexcept {
+            current.reset();
+            return {};
+        }
+        ToConsumer yield_value(T v) {
+            current = std::move(v);
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    struct NextOp {
+        Handle h;
+        bool await_ready() const noexcept { return !h || h.done(); }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> c) noexcept {
+            h.promise().consumer = c;
+            return h;
+        }
+        std::optional<T> await_resume() {
+            if (!h || h.done()) return std::nullopt;
+            return std::move(h.promise().current);
+        }
+    };
+
+    AsyncGenerator(AsyncGenerator&& o) noexcept : h(o.h) { o.h = nullptr; }
+    AsyncGenerator(const AsyncGenerator&) = delete;
+    AsyncGenerator& operator=(const AsyncGenerator&) = delete;
+    ~AsyncGenerator() {
+        if (h) h.destroy();
+    }
+
+    NextOp next() { return NextOp{ h }; }
+
+private:
+    explicit AsyncGenerator(Handle handle) : h(handle) {}
+    Handle h;
+};
+
+template <class T>
+class AsyncBinaryList {
+public:
+    explicit AsyncBinaryList(const std::string& filename);
+    ~AsyncBinaryList();  // дожидается операций, стоящих в очереди
+
+    // Где продолжать корутину после операции. По умолчанию — задачей
+    // пула ввода-вывода; цикл событий может передать свою функцию, чтобы корутины
+    // возвращались в его поток.
+    void setResumer(std::function<void(std::coroutine_handle<>)> r);
+
+    // Произвольная операция над списком: co_await call([](BinaryList<T>& l) { ... })
+    template <class F>
+    auto call(F f) -> ListOp<T, decltype(f(std::declval<BinaryList<T>&>()))> {
+        return { this, std::move(f) };
+    }
+
+    ListOp<T, void> push_back(const T& value) {
+        return call([value](BinaryList<T>& l) { l.push_back(value); });
+    }
+    ListOp<T, void> insert(int index, const T& value) {
+        return call([index, value](BinaryList<T>& l) { l.insert(index, value); });
+    }
+    ListOp<T, void> erase(int index) {
+        return call([index](BinaryList<T>& l) { l.erase(index); });
+    }
+    ListOp<T, T> get(int index) {
+        return call([index](BinaryList<T>& l) { return l.get(index); });
+    }
+    ListOp<T, void> update(int index, const T& value) {
+        return call([index, value](BinaryList<T>& l) { l.update(index, value); });
+    }
+    ListOp<T, std::optional<T>> pop_front() {
+        return call([](BinaryList<T>& l) {
+            T out{};
+            return l.pop_front(out) ? std::optional<T>(std::move(out)) : std::nullopt;
+        });
+    }
+    ListOp<T, void> sort() {
+        return call([](BinaryList<T>& l) { l.sort(); });
+    }
+    ListOp<T, int> size() {
+        return call([](BinaryList<T>& l) { return l.getSize(); });
+    }
+
+    // Обход окнами по window элементов (одно пакетное чтение getMany
+    // на окно). Изменения списка во время обхода сдвигают индексы:
+    // элементы могут пропуститься или повториться.
+    AsyncGenerator<T> items(int window = 256);
+
+private:
+    template <class, class> friend struct ListOp;
+
+    BinaryList<T> list;
+    std::mutex m;
+    std::condition_variable idle;
+    std::deque<std::function<void()>> queue;  // операции в порядке co_await
+    bool busy;                                // очередь сейчас разбирается
+    std::function<void(std::coroutine_handle<>)> resumer;
+
+    void enqueue(std::function<void()> job);
+    void pump();
+    void resume(std::coroutine_handle<> h);
+};
+
+template <class T>
+AsyncBinaryList<T>::AsyncBinaryList(const std::string& filename)
+    : list(filename), busy(false)
+{
+}
+
+template <class T>
+AsyncBinaryList<T>::~AsyncBinaryList() {
+    std::unique_lock<std::mutex> lk(m);
+    idle.wait(lk, [this] { return !busy; });
+}
+
+template <class T>
+void AsyncBinaryList<T>::setResumer(std::function<void(std::coroutine_handle<>)> r) {
+    resumer = std::move(r);
+}
+
+// Очередь разбирает одна задача пула; новая ставится, только
+// если очередь простаивала
+template <class T>
+void AsyncBinaryList<T>::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lk(m);
+        queue.push_back(std::move(job));
+        if (busy) return;
+        busy = true;
+    }
+    WorkerPool::io().post([this] { pump(); });
+}
+
+template <class T>
+void AsyncBinaryList<T>::pump() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::lock_guard<std::mutex> lk(m);
+            if (queue.empty()) {
+                busy = false;
+                idle.notify_all();
+                return;
+            }
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        job();
+    }
+}
+
+// Корутину не продолжаем внутри pump: иначе она заняла бы очередь
+// списка до своей следующей приостановки. Пул ввода-вывода всегда
+// ставит задачу в очередь, поэтому продолжение не случится и внутри
+// await_suspend вызывающей корутины.
+template <class T>
+void AsyncBinaryList<T>::resume(std::coroutine_handle<> h) {
+    if (resumer) resumer(h);
+    else WorkerPool::io().post([h] { h.resume(); });
+}
+
+template <class T>
+AsyncGenerator<T> AsyncBinaryList<T>::items(int window) {
+    if (window < 1) window = 1;
+    for (int from = 0; ; from += window) {
+        std::vector<T> batch = co_await call([from, window](BinaryList<T>& l) {
+            std::vector<int> idx;
+            for (int i = from; i < from + window && i < l.getSize(); i++) idx.push_back(i);
+            std::vector<T> out;
+            l.getMany(idx, out);
+            return out;
+        });
+        if (batch.empty()) co_return;
+        for (T& v : batch) {
+            co_yield std::move(v);
+        }
+    }
+}
+
+// Корутина верхнего уровня для обычного кода: стартует сразу,
+// wait() блокирует вызывающий поток до её завершения
+class SyncTask {
+public:
+    struct promise_type {
+        std::mutex m;
+        std::condition_variable cv;
+        bool done = false;
+
+        // Сигнал под мьютексом: после его освобождения кадр корутины
+        // уже не трогаем, и wait() может его уничтожить
+        struct Finish {
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                promise_type& p = h.promise();
+                std::lock_guard<std::mutex> lk(p.m);
+                p.done = true;
+                p.cv.notify_all();
+            }
+            void await_resume() const noexcept {}
+        };
+
+        SyncTask get_return_object() {
+            return SyncTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        Finish final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    SyncTask(const SyncTask&) = delete;
+    SyncTask& operator=(const SyncTask&) = delete;
+    ~SyncTask() {
+        wait();
+        h.destroy();
+    }
+
+    void wait() {
+        promise_type& p = h.promise();
+        std::unique_lock<std::mutex> lk(p.m);
+        p.cv.wait(lk, [&p] { return p.done; });
+    }
+
+private:
+    explicit SyncTask(std::coroutine_handle<promise_type> handle) : h(handle) {}
+    std::coroutine_handle<promise_type> h;
+};
+#endif  // BL_HAVE_COROUTINES
+
+//--------------------------------------------------------------
+// 5) Генератор нагрузки «очередь»: производители push_back,
+//    потребители pop_front на одном файле списка.
+//    Потоки делят один BinaryList под мьютексом; процессы
+//    (fork, только POSIX) открывают файл каждый сам и работают
+//    под FileLock, перечитывая заголовок (refresh) перед операцией.
+//    В значение записывается время постановки (мкс от старта),
+//    потребитель по нему считает задержку «постановка → снятие».
+//--------------------------------------------------------------
+
+// Гистограмма задержек в духе HDR: значения до 32 точны, дальше
+// каждая октава [2^k, 2^(k+1)) делится на 32 корзины (погрешность
+// ~3%). Простая структура без указателей — её можно передать из
+// дочернего процесса через канал как есть.
+struct LatencyHistogram {
+    static const int SUB = 32;
+    static const int BUCKETS = SUB + 59 * SUB;
+
+    long long counts[BUCKETS];
+    long long total;
+    long long sum;
+    long long maxValue;
+
+    LatencyHistogram() { reset(); }
+
+    void reset() {
+        std::memset(counts, 0, sizeof(counts));
+        total = sum = maxValue = 0;
+    }
+    static int bucketOf(long long v) {
+        if (v < SUB) return (int)std::max(v, 0LL);
+        int msb = 63;
+        while (!(v >> msb)) msb--;
+        int shift = msb - 5;
+        return SUB + shift * SUB + (int)((v >> shift) - SUB);
+    }
+    // Наибольшее значение, попадающее в корзину
+    static long long upperOf(int b) {
+        if (b < SUB) return b;
+        int shift = (b - SUB) / SUB;
+        long long mant = SUB + (b - SUB) % SUB;
+        return ((mant + 1) << shift) - 1;
+    }
+    void record(long long v) {
+        counts[bucketOf(v)]++;
+        total++;
+        sum += v;
+        maxValue = std::max(maxValue, v);
+    }
+    void add(const LatencyHistogram& o) {
+        for (int b = 0; b < BUCKETS; b++) counts[b] += o.counts[b];
+        total += o.total;
+        sum += o.sum;
+        maxValue = std::max(maxValue, o.maxValue);
+    }
+    long long percentile(double p) const {
+        if (total == 0) return 0;
+        long long need = std::max(1LL, (long long)(p / 100.0 * total + 0.5));
+        long long seen = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            seen += counts[b];
+            if (seen >= need) return std::min(upperOf(b), maxValue);
+        }
+        return maxValue;
+    }
+    double mean() const { return total ? (double)sum / total : 0; }
+};
+
+struct LoadGenConfig {
+    int    producers;
+    int    consumers;
+    bool   processes;   // процессы (fork) вместо потоков
+    double rate;        // операций/с на производителя (0 — без ограничения)
+    double seconds;     // длительность постановки
+    int    minLen;      // длина строк-значений (для string)
+    int    maxLen;
+    int    sampleMs;    // период замера размера файла
+
+    LoadGenConfig()
+        : producers(1), consumers(1), processes(false), rate(0), seconds(5),
+          minLen(8), maxLen(64), sampleMs(500) {}
+};
+
+struct GrowthSample {
+    double    t;          // с от старта
+    long long fileBytes;
+    int       size;       // элементов в очереди
+};
+
+struct LoadGenResult {
+    LatencyHistogram latency;  // постановка → снятие, мкс
+    long long produced;
+    long long consumed;
+    double    elapsed;         // с
+    std::vector<GrowthSample> growth;
+};
+
+// Значение с отметкой времени для каждого типа записи
+// (отметка — int мкс от старта, то есть прогон до ~35 минут)
+template <class T>
+struct LoadPayload;
+
+template <>
+struct LoadPayload<int> {
+    static void make(int stamp, std::mt19937&, const LoadGenConfig&, int& v) { v = stamp; }
+    static int stamp(const int& v) { return v; }
+};
+
+template <>
+struct LoadPayload<Person> {
+    static void make(int stamp, std::mt19937& rng, const LoadGenConfig&, Person& v) {
+        std::snprintf(v.name, sizeof(v.name), "load-%u", (unsigned)rng() % 100000);
+        v.age = stamp;
+    }
+    static int stamp(const Person& v) { return v.age; }
+};
+
+template <>
+struct LoadPayload<std::string> {
+    static void make(int stamp, std::mt19937& rng, const LoadGenConfig& cfg, std::string& v) {
+        v.clear();
+        formatInt(stamp, v);
+        v += ':';
+        int len = cfg.minLen + (int)(rng() % (unsigned)(cfg.maxLen - cfg.minLen + 1));
+        if ((int)v.size() < len) v.append(len - v.size(), 'x');
+    }
+    static int stamp(const std::string& v) {
+        int s = 0;
+        std::from_chars(v.data(), v.data() + v.size(), s);
+        return s;
+    }
+};
+
+// Доступ к очереди: общий список под мьютексом (потоки) или свой
+// список под FileLock с перечитыванием заголовка (процессы)
+template <class T>
+class LoadQueue {
+public:
+    LoadQueue(BinaryList<T>& l, std::mutex* mtx, FileLock* fl) : list(l), m(mtx), flock(fl) {}
+
+    void push(const T& v) {
+        enter();
+        list.push_back(v);
+        leave();
+    }
+    bool pop(T& v) {
+        enter();
+        bool ok = list.getSize() > 0 && list.pop_front(v);
+        leave();
+        return ok;
+    }
+    // Ожидание постановки без опроса (см. BinaryList::waitChange)
+    unsigned long long seq() const { return list.appendSeq(); }
+    void waitPush(unsigned long long seen, int timeoutMs) const { list.waitChange(seen, timeoutMs); }
+    // Размер файла и очереди (для замеров роста)
+    GrowthSample sample(double t) {
+        enter();
+        list.seekg(0, std::ios::end);
+        GrowthSample s{ t, (long long)list.tellg(), list.getSize() };
+        leave();
+        return s;
+    }
+
+private:
+    void enter() {
+        if (m) m->lock();
+        if (flock) {
+            flock->lock();
+            list.refresh();
+        }
+    }
+    void leave() {
+        if (flock) {
+            list.flush();  // другой процесс должен увидеть запись после unlock
+            flock->unlock();
+        }
+        if (m) m->unlock();
+    }
+
+    BinaryList<T>& list;
+    std::mutex* m;
+    FileLock* flock;
+};
+
+typedef std::chrono::steady_clock LoadClock;
+
+inline int loadStamp(LoadClock::time_point start) {
+    return (int)std::chrono::duration_cast<std::chrono::microseconds>(LoadClock::now() - start).count();
+}
+
+// Производитель: ставит значения до deadline с заданной частотой
+// (по расписанию от старта, без «догоняющих» пауз)
+template <class T>
+long long loadProduce(LoadQueue<T>& q, const LoadGenConfig& cfg, int id,
+                      LoadClock::time_point start, LoadClock::time_point deadline) {
+    std::mt19937 rng(1234u + id);
+    T v{};
+    long long n = 0;
+    while (true) {
+        if (cfg.rate > 0) {
+            auto due = start + std::chrono::duration_cast<LoadClock::duration>(
+                std::chrono::duration<double>(n / cfg.rate));
+            if (due >= deadline) break;
+            std::this_thread::sleep_until(due);
+        }
+        else if (LoadClock::now() >= deadline) {
+            break;
+        }
+        LoadPayload<T>::make(loadStamp(start), rng, cfg, v);
+        q.push(v);
+        n++;
+    }
+    return n;
+}
+
+// Потребитель: снимает, пока идёт постановка, затем дочищает очередь
+template <class T>
+long long loadConsume(LoadQueue<T>& q, LatencyHistogram& h, LoadClock::time_point start,
+                      LoadClock::time_point deadline) {
+    T v{};
+    long long n = 0;
+    auto grace = deadline + std::chrono::milliseconds(200);  // последние push_back производителей
+    while (true) {
+        unsigned long long seen = q.seq();
+        if (q.pop(v)) {
+            h.record(loadStamp(start) - LoadPayload<T>::stamp(v));
+            n++;
+        }
+        else if (LoadClock::now() > grace) {
+            break;
+        }
+        else {
+            q.waitPush(seen, 50);  // спит до push_back (или записи другого процесса)
+        }
+    }
+    return n;
+}
+
+#if BL_HAVE_PREAD
+// Запись/чтение всего буфера через канал (write/read могут быть частичными)
+inline bool pipeAll(int fd, char* p, size_t n, bool out) {
+    while (n > 0) {
+        ssize_t r = out ? ::write(fd, p, n) : ::read(fd, p, n);
+        if (r <= 0) return false;
+        p += r;
+        n -= (size_t)r;
+    }
+    return true;
+}
+#endif
+
+template <class T>
+LoadGenResult runLoadGen(const std::string& fname, const LoadGenConfig& cfg) {
+    LoadGenResult res;
+    res.produced = res.consumed = 0;
+    res.elapsed = 0;
     {
+        BinaryList<T> init(fname);
+        init.clear();  // очередь начинается пустой
+    }
+    BinaryList<T> list(fname);
+    std::mutex m;
+    FileLock flock(fname + ".lock");
+    bool procs = cfg.processes && BL_HAVE_PREAD;
+    if (cfg.processes && !procs) {
+        std::cout << "[" << NodeCodec<T>::tag() << "] Процессы недоступны, запуск потоками\n";
+    }
+    LoadQueue<T> shared(list, procs ? nullptr : &m, procs ? &flock : nullptr);
+
+    auto start = LoadClock::now();
+    auto deadline = start + std::chrono::duration_cast<LoadClock::duration>(
+        std::chrono::duration<double>(cfg.seconds));
+    int workers = cfg.producers + cfg.consumers;
+    std::vector<LatencyHistogram> hist(cfg.consumers);
+    std::vector<long long> done(workers, 0);
+    std::atomic<int> running(workers);
+
+    std::vector<std::thread> threads;
+#if BL_HAVE_PREAD
+    std::vector<pid_t> pids;
+    std::vector<int> pipes;
+#endif
+    for (int w = 0; w < workers; w++) {
+        bool producer = w < cfg.producers;
+#if BL_HAVE_PREAD
+        if (procs) {
+            int fds[2];
+            if (::pipe(fds) != 0) break;
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                // Дочерний процесс: свой дескриптор и своя блокировка
+                ::close(fds[0]);
+                BinaryList<T> own(fname);
+                FileLock ownLock(fname + ".lock");
+                LoadQueue<T> q(own, nullptr, &ownLock);
+                LatencyHistogram h;
+                long long n = producer ? loadProduce(q, cfg, w, start, deadline)
+                                       : loadConsume(q, h, start, deadline);
+                own.close();
+                pipeAll(fds[1], reinterpret_cast<char*>(&n), sizeof(n), true);
+                pipeAll(fds[1], reinterpret_cast<char*>(&h), sizeof(h), true);
+                ::_exit(0);
+            }
+            ::close(fds[1]);
+            pids.push_back(pid);
+            pipes.push_back(fds[0]);
+            continue;
+        }
+#endif
+        threads.emplace_back([&, w, producer] {
+            if (producer) done[w] = loadProduce(shared, cfg, w, start, deadline);
+            else done[w] = loadConsume(shared, hist[w - cfg.producers], start, deadline);
+            running--;
+        });
+    }
+
+    // Замеры роста файла, пока работают участники
+    auto elapsedSec = [&] {
+        return std::chrono::duration<double>(LoadClock::now() - start).count();
+    };
+    while (true) {
+        bool alive = running > 0;
+#if BL_HAVE_PREAD
+        if (procs) {
+            alive = false;
+            for (pid_t pid : pids) {
+                if (pid > 0 && ::waitpid(pid, nullptr, WNOHANG) == 0) alive = true;
+            }
+        }
+#endif
+        res.growth.push_back(shared.sample(elapsedSec()));
+        if (!alive) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(cfg.sampleMs));
+    }
+    for (auto& t : threads) t.join();
+#if BL_HAVE_PREAD
+    for (size_t i = 0; i < pipes.size(); i++) {
+        LatencyHistogram h;
+        long long n = 0;
+        if (pipeAll(pipes[i], reinterpret_cast<char*>(&n), sizeof(n), false)
+            && pipeAll(pipes[i], reinterpret_cast<char*>(&h), sizeof(h), false)) {
+            done[i] = n;
+            if ((int)i >= cfg.producers) hist[i - cfg.producers] = h;
+        }
+        ::close(pipes[i]);
+        ::waitpid(pids[i], nullptr, 0);
+    }
+#endif
+    res.elapsed = elapsedSec();
+    for (int w = 0; w < workers; w++) {
+        if (w < cfg.producers) res.produced += done[w];
+        else res.consumed += done[w];
+    }
+    for (auto& h : hist) res.latency.add(h);
+    return res;
+}
+
+void printLoadGenResult(const LoadGenResult& r, const char* tag) {
+    const LatencyHistogram& h = r.latency;
+    std::cout << "[" << tag << "] Нагрузка за " << r.elapsed << " с:\n"
+              << "  поставлено / снято: " << r.produced << " / " << r.consumed << "\n"
+              << "  пропускная способность: "
+              << (long long)(r.elapsed > 0 ? r.consumed / r.elapsed : 0) << " снятий/с\n"
+              << "  задержка постановка→снятие, мкс:\n"
+              << "    ср " << (long long)h.mean()
+              << ", p50 " << h.percentile(50) << ", p90 " << h.percentile(90)
+              << ", p99 " << h.percentile(99) << ", p99.9 " << h.percentile(99.9)
+              << ", макс " << h.maxValue << "\n"
+              << "  рост файла (с: байт, элементов):\n";
+    for (const GrowthSample& s : r.growth) {
+        std::cout << "    " << s.t << ": " << s.fileBytes << ", " << s.size << "\n";
+    }
+}
+
+//--------------------------------------------------------------
+// 6) Файл-контейнер ListContainer: много именованных списков
+//    в одном файле.
+//      [ContainerHeader][блок каталога][узлы ...][блок каталога]...
+//    Блок каталога — DIR_ENTRIES записей «имя, тип, FileHeader»;
+//    заголовки списков лежат рядом, каталог читается при открытии
+//    контейнера одним проходом по блокам. open<T>(имя) даёт обычный
+//    BinaryList<T>, у которого заголовок — в записи каталога, а
+//    новые узлы всех списков занимают общий конец файла
+//    (ContainerSpace). Свободные слоты (freeHead, slabHead) у каждого
+//    списка свои. На файл — один ListContainer в одном процессе.
+//--------------------------------------------------------------
+const int CONTAINER_MAGIC = 0x584F424C;  // "LBOX"
+const int CONTAINER_VERSION = 1;
+const int DIR_ENTRIES = 64;     // записей в блоке каталога
+const int LIST_NAME_MAX = 47;   // байт в имени списка (без '\0')
+
+struct ContainerHeader {
+    int magic;     // CONTAINER_MAGIC
+    int version;
+    int count;     // число списков
+    int firstDir;  // позиция первого блока каталога
+    int reserved[12];
+};
+
+struct DirEntry {
+    char name[LIST_NAME_MAX + 1];  // '\0' в начале — запись свободна
+    int  elemSize;                 // размер элемента, -1 — строки (проверка типа в open)
+    int  reserved[3];
+    FileHeader header;             // заголовок списка (BinaryList::base указывает сюда)
+};
+
+struct DirBlock {
+    int next;  // следующий блок каталога (0 — последний)
+    int reserved[15];
+    DirEntry entries[DIR_ENTRIES];
+};
+
+struct ListInfo {
+    std::string name;
+    int elemSize;  // -1 — строки
+    int size;      // число элементов по заголовку на диске
+};
+
+class ListContainer {
+public:
+    explicit ListContainer(const std::string& filename);
+
+    bool is_open() const;
+    // Список по имени; если его нет — создаётся пустым. nullptr, если
+    // имя не подходит или список хранит другой тип. Список открывается
+    // одним open файла и чтением своего заголовка; закрыть его нужно
+    // до удаления контейнера или erase этого имени.
+    template <class T> std::unique_ptr<BinaryList<T>> open(const std::string& name);
+    bool contains(const std::string& name);
+    bool erase(const std::string& name);  // узлы списка становятся мёртвым местом
+    int  size();
+    std::vector<ListInfo> lists();        // по порядку записей каталога
+
+private:
+    std::string fname;
+    std::fstream file;
+    ContainerHeader ch;
+    std::shared_ptr<ContainerSpace> space;
+    std::map<std::string, int> dir;       // имя -> позиция записи каталога
+    std::vector<int> freeEntries;         // свободные записи (стек, младшая — сверху)
+    int lastBlock;                        // позиция последнего блока каталога
+    std::mutex m;
+
+    void addBlock();
+    int  addEntry(const std::string& name, int elemSize);
+    void writeCount();
+};
+
+ListContainer::ListContainer(const std::string& filename)
+    : fname(filename), space(std::make_shared<ContainerSpace>()), lastBlock(0)
+{
+    std::memset(&ch, 0, sizeof(ch));
+    space->end = 0;
+    file.open(fname.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
         std::ofstream ff(fname.c_str(), std::ios::binary);
         ff.close();
+        file.open(fname.c_str(), std::ios::in | std::ios::out | std::ios::binary);
     }
-    open(fname.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    if (!file.is_open()) return;
 
-    fh.head = -1;
-    fh.tail = -1;
-    fh.size = 0;
-    writeHeader();
+    file.seekg(0, std::ios::end);
+    int sz = (int)file.tellg();
+    if (sz == 0) {
+        ch.magic = CONTAINER_MAGIC;
+        ch.version = CONTAINER_VERSION;
+        ch.firstDir = (int)sizeof(ContainerHeader);
+        file.seekp(0, std::ios::beg);
+        file.write(reinterpret_cast<const char*>(&ch), sizeof(ch));
+        space->end = (int)sizeof(ContainerHeader);
+        addBlock();
+        file.flush();
+        return;
+    }
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char*>(&ch), sizeof(ch));
+    if (!file.good() || ch.magic != CONTAINER_MAGIC) {
+        std::cout << "Файл " << fname << " не является контейнером списков\n";
+        file.close();
+        return;
+    }
+    space->end = sz;
+
+    // Каталог — только блоки записей, узлы списков не читаются
+    std::vector<DirBlock> blk(1);
+    for (int b = ch.firstDir; b > 0 && b < sz; b = blk[0].next) {
+        file.seekg(b, std::ios::beg);
+        file.read(reinterpret_cast<char*>(blk.data()), sizeof(DirBlock));
+        if (!file.good()) {
+            file.clear();
+            break;
+        }
+        lastBlock = b;
+        for (int i = DIR_ENTRIES - 1; i >= 0; i--) {
+            const DirEntry& e = blk[0].entries[i];
+            int pos = b + (int)offsetof(DirBlock, entries) + i * (int)sizeof(DirEntry);
+            if (e.name[0] != '\0') {
+                dir[std::string(e.name, std::find(e.name, e.name + sizeof(e.name), '\0'))] = pos;
+            }
+            else {
+                freeEntries.push_back(pos);
+            }
+        }
+    }
 }
 
-// print
-void BinaryList<std::string>::print() {
-    if (fh.size == 0) {
-        std::cout << "[string] Список пуст.\n";
-        return;
+bool ListContainer::is_open() const {
+    return file.is_open();
+}
+
+// Новый блок каталога — в общий конец файла; записи его — в стек свободных
+void ListContainer::addBlock() {
+    int pos;
+    {
+        std::lock_guard<std::mutex> lk(space->m);
+        pos = space->end;
+        space->end = pos + (int)sizeof(DirBlock);
     }
-    std::cout << "[string] Содержимое (size=" << fh.size << "):\n";
-    int cur = fh.head;
-    for (int i = 0; i < fh.size; i++) {
-        seekg(cur, std::ios::beg);
-        int p, n;
-        read(reinterpret_cast<char*>(&p), sizeof(int));
-        read(reinterpret_cast<char*>(&n), sizeof(int));
-        std::string s = readString();
-        std::cout << "  [" << i << "]: " << s << "\n";
-        cur = n;
+    std::vector<DirBlock> blk(1);
+    std::memset(blk.data(), 0, sizeof(DirBlock));
+    file.seekp(pos, std::ios::beg);
+    file.write(reinterpret_cast<const char*>(blk.data()), sizeof(DirBlock));
+    if (pos != ch.firstDir) {
+        file.seekp(lastBlock + (int)offsetof(DirBlock, next), std::ios::beg);
+        file.write(reinterpret_cast<const char*>(&pos), sizeof(int));
+    }
+    lastBlock = pos;
+    for (int i = DIR_ENTRIES - 1; i >= 0; i--) {
+        freeEntries.push_back(pos + (int)offsetof(DirBlock, entries) + i * (int)sizeof(DirEntry));
     }
 }
 
-int BinaryList<std::string>::getSize() const {
-    return fh.size;
+// Запись с обнулённым заголовком: список инициализирует его сам
+int ListContainer::addEntry(const std::string& name, int elemSize) {
+    if (freeEntries.empty()) {
+        addBlock();
+    }
+    int pos = freeEntries.back();
+    freeEntries.pop_back();
+    DirEntry e;
+    std::memset(&e, 0, sizeof(e));
+    std::memcpy(e.name, name.data(), name.size());
+    e.elemSize = elemSize;
+    file.seekp(pos, std::ios::beg);
+    file.write(reinterpret_cast<const char*>(&e), sizeof(e));
+    dir[name] = pos;
+    writeCount();
+    return pos;
 }
 
-// Итератор
-void BinaryList<std::string>::initIterator() {
-    iterPos = fh.head;
+void ListContainer::writeCount() {
+    ch.count = (int)dir.size();
+    file.seekp(0, std::ios::beg);
+    file.write(reinterpret_cast<const char*>(&ch), sizeof(ch));
+    file.flush();  // списки читают свои записи через собственные дескрипторы
 }
 
-bool BinaryList<std::string>::hasNext() {
-    return (iterPos != -1);
+template <class T>
+std::unique_ptr<BinaryList<T>> ListContainer::open(const std::string& name) {
+    std::unique_ptr<BinaryList<T>> out;
+    if (!file.is_open()) return out;
+    // Имя входит в имена файлов-спутников (контейнер#имя.hidx)
+    if (name.empty() || name.size() > (size_t)LIST_NAME_MAX
+        || name.find_first_of("/\\") != std::string::npos) {
+        std::cout << "Имя списка должно быть от 1 до " << LIST_NAME_MAX
+                  << " байт и без / и \\: " << name << "\n";
+        return out;
+    }
+    int elemSize = NodeCodec<T>::fixedSize ? NodeCodec<T>::size : -1;
+    int pos;
+    {
+        std::lock_guard<std::mutex> lk(m);
+        auto it = dir.find(name);
+        if (it == dir.end()) {
+            pos = addEntry(name, elemSize);
+        }
+        else {
+            pos = it->second;
+            int stored;
+            file.seekg(pos + (int)offsetof(DirEntry, elemSize), std::ios::beg);
+            file.read(reinterpret_cast<char*>(&stored), sizeof(int));
+            if (stored != elemSize) {
+                std::cout << "Список " << name << " в " << fname << " хранит другой тип ("
+                          << (stored < 0 ? std::string("string") : std::to_string(stored) + " байт")
+                          << ")\n";
+                return out;
+            }
+        }
+    }
+    out.reset(new BinaryList<T>(fname, name, pos + (int)offsetof(DirEntry, header), space));
+    return out;
 }
 
-std::string BinaryList<std::string>::next() {
-    if (iterPos == -1) return "";
-    seekg(iterPos, std::ios::beg);
-    int p, n;
-    read(reinterpret_cast<char*>(&p), sizeof(int));
-    read(reinterpret_cast<char*>(&n), sizeof(int));
-    std::string s = readString();
-    iterPos = n;
-    return s;
+bool ListContainer::contains(const std::string& name) {
+    std::lock_guard<std::mutex> lk(m);
+    return dir.count(name) != 0;
+}
+
+// Запись освобождается и достанется следующему новому имени;
+// спутники списка (индекс, фильтр) удаляются вместе с ней
+bool ListContainer::erase(const std::string& name) {
+    std::lock_guard<std::mutex> lk(m);
+    auto it = dir.find(name);
+    if (it == dir.end()) return false;
+    DirEntry e;
+    std::memset(&e, 0, sizeof(e));
+    file.seekp(it->second, std::ios::beg);
+    file.write(reinterpret_cast<const char*>(&e), sizeof(e));
+    freeEntries.push_back(it->second);
+    dir.erase(it);
+    writeCount();
+    std::string list = fname + "#" + name;
+    std::remove((list + ".hidx").c_str());
+    std::remove((list + ".bloom").c_str());
+    return true;
+}
+
+int ListContainer::size() {
+    std::lock_guard<std::mutex> lk(m);
+    return (int)dir.size();
+}
+
+// Размеры — из заголовков на диске: открытый список пишет свой
+// заголовок через собственный буфер, нужен его flush()
+std::vector<ListInfo> ListContainer::lists() {
+    std::lock_guard<std::mutex> lk(m);
+    std::vector<std::pair<int, std::string>> order;
+    for (const auto& d : dir) order.push_back({ d.second, d.first });
+    std::sort(order.begin(), order.end());
+    std::vector<ListInfo> out;
+    for (const auto& o : order) {
+        DirEntry e;
+        file.seekg(o.first, std::ios::beg);
+        file.read(reinterpret_cast<char*>(&e), sizeof(e));
+        bool fresh = e.header.magic != HEADER_MAGIC;  // список ещё не открывался
+        out.push_back(ListInfo{ o.second, e.elemSize, fresh ? 0 : e.header.size });
+    }
+    return out;
 }
 
 //-----------------------------------------------------
@@ -927,53 +6232,306 @@ std::string BinaryList<std::string>::next() {
 void menuInt();
 void menuString();
 void menuPerson();
+void menuSegmented();
+
+// Неинтерактивные команды (см. runCli)
+int runCli(int argc, char* argv[]);
+
+//-----------------------------------------------------
+// main
+//-----------------------------------------------------
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        return runCli(argc, argv);
+    }
+
+    //setlocale(LC_ALL, "");  // русская локаль под Windows если требуется
+
+    while (true) {
+        system("cls");  // Очистка экрана (Windows). Если вы на *nix, уберите или замените.
+        std::cout << "==== Главное Меню ====\n"
+            << "1. int\n"
+            << "2. string\n"
+            << "3. Person\n"
+            << "4. int (сегментированная очередь)\n"
+            << "0. Выход\n"
+            << "======================\n"
+            << "Ваш выбор: ";
+        int c;
+        std::cin >> c;
+        if (!std::cin.good()) {
+            std::cin.clear();
+            std::cin.ignore(9999, '\n');
+            continue;
+        }
+        if (c == 0) {
+            break;
+        }
+        switch (c) {
+        case 1:
+            menuInt();
+            break;
+        case 2:
+            menuString();
+            break;
+        case 3:
+            menuPerson();
+            break;
+        case 4:
+            menuSegmented();
+            break;
+        default:
+            std::cout << "Пока не реализовано.\n";
+            system("pause");
+        }
+    }
+
+    std::cout << "\nПрограмма завершена.\n";
+    return 0;
+}
+
+//-----------------------------------------------------
+// Командная строка:
+//   course_binary analyze <int|string|person> <файл> [--compact]
+//   course_binary verify  <int|string|person> <файл> [--rebuild|--crc-on|--crc-off]
+//   course_binary backup  <int|string|person> <файл> <копия>
+//   course_binary lists   <контейнер>
+//   course_binary import  <int|string|person> <файл> <источник> [--text|--csv|--raw]
+//   course_binary export  <int|string|person> <файл> <приёмник> [--text|--csv|--raw]
+//   course_binary loadgen <int|string|person> <файл> [--producers N] [--consumers N]
+//                 [--processes] [--rate R] [--seconds S] [--len MIN:MAX]
+//   course_binary async   <int|string|person> <файл> [N]   (сборка C++20)
+//-----------------------------------------------------
+// Команды, читающие готовый файл, сначала проверяют, что он есть:
+// конструктор BinaryList молча создал бы пустой
+bool fileExists(const std::string& file) {
+    std::ifstream probe(file, std::ios::binary);
+    if (!probe) {
+        std::cout << "Файл не найден: " << file << "\n";
+        return false;
+    }
+    return true;
+}
+
+template <class T>
+int cliAnalyze(const std::string& file, bool doCompact) {
+    if (!fileExists(file)) {
+        return 1;
+    }
+    BinaryList<T> list(file);
+    if (!list.is_open()) {
+        return 1;
+    }
+    LayoutReport r = list.analyze();
+    printLayoutReport(r, NodeCodec<T>::tag());
+    if (doCompact) {
+        list.compact();
+        printLayoutReport(list.analyze(), NodeCodec<T>::tag());
+    }
+    return 0;
+}
+
+template <class T>
+int cliVerify(const std::string& file, const std::string& action) {
+    if (!fileExists(file)) {
+        return 1;
+    }
+    BinaryList<T> list(file);
+    if (!list.is_open()) {
+        return 1;
+    }
+    if (action == "--crc-on") list.enableChecksums();
+    if (action == "--crc-off") list.disableChecksums();
+    VerifyReport r = list.verify();
+    printVerifyReport(r, NodeCodec<T>::tag());
+    if (action == "--rebuild" && !r.ok()) {
+        list.rebuild();
+        r = list.verify();
+        printVerifyReport(r, NodeCodec<T>::tag());
+    }
+    return r.ok() ? 0 : 3;
+}
+
+template <class T>
+int cliBackup(const std::string& file, const std::string& dest) {
+    if (!fileExists(file)) {
+        return 1;
+    }
+    BinaryList<T> list(file);
+    return list.is_open() && list.snapshot_to(dest) ? 0 : 1;
+}
+
+template <class T>
+int cliTransfer(bool import, const std::string& file, const std::string& other, DataFormat fmt) {
+    if (!import && !fileExists(file)) {
+        return 1;
+    }
+    BinaryList<T> list(file);
+    if (!list.is_open()) {
+        return 1;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    long long n = import ? list.importFile(other, fmt) : list.exportFile(other, fmt);
+    if (n < 0) {
+        return 1;
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << (import ? "Импорт: " : "Экспорт: ") << n << " записей за " << sec << " с";
+    if (sec > 0) std::cout << " (" << (long long)(n / sec) << " записей/с)";
+    std::cout << "\n";
+    return 0;
+}
+
+template <class T>
+int cliLoadGen(const std::string& file, const LoadGenConfig& cfg) {
+    LoadGenResult r = runLoadGen<T>(file, cfg);
+    printLoadGenResult(r, NodeCodec<T>::tag());
+    return 0;
+}
+
+#if BL_HAVE_COROUTINES
+// N дописываний через co_await и обход items(); корутина продолжается
+// на потоках WorkerPool::io(), основной поток только ждёт её конца
+template <class T>
+SyncTask asyncRun(AsyncBinaryList<T>& list, int n, int& before, int& seen) {
+    std::mt19937 rng(12345);
+    LoadGenConfig cfg;
+    T v{};
+    before = co_await list.size();
+    for (int i = 0; i < n; i++) {
+        LoadPayload<T>::make(before + i, rng, cfg, v);
+        co_await list.push_back(v);
+    }
+    AsyncGenerator<T> it = list.items();
+    while (co_await it.next()) {
+        seen++;
+    }
+}
+#endif
 
-//-----------------------------------------------------
-// main
-//-----------------------------------------------------
-int main() {
-   
-    //setlocale(LC_ALL, "");  // русская локаль под Windows если требуется
+template <class T>
+int cliAsync(const std::string& file, int n) {
+#if BL_HAVE_COROUTINES
+    AsyncBinaryList<T> list(file);
+    int before = 0, seen = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    asyncRun<T>(list, n, before, seen).wait();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "[" << NodeCodec<T>::tag() << "] async: было " << before << ", добавлено " << n
+              << ", обойдено " << seen << " за " << sec << " с\n";
+    return seen == before + n ? 0 : 3;
+#else
+    (void)file;
+    (void)n;
+    std::cout << "AsyncBinaryList нужна сборка с -std=c++20\n";
+    return 1;
+#endif
+}
 
-    while (true) {
-        system("cls");  // Очистка экрана (Windows). Если вы на *nix, уберите или замените.
-        std::cout << "==== Главное Меню ====\n"
-            << "1. int\n"
-            << "2. string\n"
-            << "3. Person\n"
-            << "0. Выход\n"
-            << "======================\n"
-            << "Ваш выбор: ";
-        int c;
-        std::cin >> c;
-        if (!std::cin.good()) {
-            std::cin.clear();
-            std::cin.ignore(9999, '\n');
+// Ключи loadgen; false — неизвестный ключ или плохое значение
+bool parseLoadGenArgs(int argc, char* argv[], int from, LoadGenConfig& cfg) {
+    for (int i = from; i < argc; i++) {
+        std::string k = argv[i];
+        if (k == "--processes") {
+            cfg.processes = true;
             continue;
         }
-        if (c == 0) {
-            break;
-        }
-        switch (c) {
-        case 1:
-            menuInt();
-            break;
-        case 2:
-            menuString();
-            break;
-        case 3:
-            menuPerson();
-            break;
-        default:
-            std::cout << "Пока не реализовано.\n";
-            system("pause");
+        if (i + 1 >= argc) return false;
+        std::string v = argv[++i];
+        if (k == "--producers") cfg.producers = std::atoi(v.c_str());
+        else if (k == "--consumers") cfg.consumers = std::atoi(v.c_str());
+        else if (k == "--rate") cfg.rate = std::atof(v.c_str());
+        else if (k == "--seconds") cfg.seconds = std::atof(v.c_str());
+        else if (k == "--len") {
+            if (std::sscanf(v.c_str(), "%d:%d", &cfg.minLen, &cfg.maxLen) != 2) return false;
         }
+        else return false;
     }
+    return cfg.producers >= 0 && cfg.consumers >= 0 && cfg.producers + cfg.consumers > 0
+        && cfg.seconds > 0 && cfg.minLen >= 0 && cfg.maxLen >= cfg.minLen;
+}
 
-    std::cout << "\nПрограмма завершена.\n";
+// Каталог контейнера: имя, тип и размер каждого списка
+int cliLists(const std::string& file) {
+    if (!fileExists(file)) {
+        return 1;
+    }
+    ListContainer box(file);
+    if (!box.is_open()) {
+        return 1;
+    }
+    std::vector<ListInfo> all = box.lists();
+    std::cout << "Списков в " << file << ": " << all.size() << "\n";
+    for (const ListInfo& li : all) {
+        std::cout << "  " << li.name << " ("
+                  << (li.elemSize < 0 ? std::string("string") : std::to_string(li.elemSize) + " байт")
+                  << "): " << li.size << " эл.\n";
+    }
     return 0;
 }
 
+int runCli(int argc, char* argv[]) {
+    std::string cmd = argv[1];
+    std::string type = argc > 2 ? argv[2] : "";
+    if (cmd == "analyze" && argc >= 4) {
+        bool doCompact = argc >= 5 && std::string(argv[4]) == "--compact";
+        if (type == "int") return cliAnalyze<int>(argv[3], doCompact);
+        if (type == "string") return cliAnalyze<std::string>(argv[3], doCompact);
+        if (type == "person") return cliAnalyze<Person>(argv[3], doCompact);
+    }
+    if (cmd == "verify" && argc >= 4) {
+        std::string a = argc >= 5 ? argv[4] : "";
+        if (a.empty() || a == "--rebuild" || a == "--crc-on" || a == "--crc-off") {
+            if (type == "int") return cliVerify<int>(argv[3], a);
+            if (type == "string") return cliVerify<std::string>(argv[3], a);
+            if (type == "person") return cliVerify<Person>(argv[3], a);
+        }
+    }
+    if (cmd == "backup" && argc >= 5) {
+        if (type == "int") return cliBackup<int>(argv[3], argv[4]);
+        if (type == "string") return cliBackup<std::string>(argv[3], argv[4]);
+        if (type == "person") return cliBackup<Person>(argv[3], argv[4]);
+    }
+    if (cmd == "lists" && argc >= 3) {
+        return cliLists(argv[2]);
+    }
+    if ((cmd == "import" || cmd == "export") && argc >= 5) {
+        std::string f = argc >= 6 ? argv[5] : "--text";
+        bool import = (cmd == "import");
+        DataFormat fmt = f == "--csv" ? DF_CSV : f == "--raw" ? DF_RAW : DF_TEXT;
+        if (f == "--text" || f == "--csv" || f == "--raw") {
+            if (type == "int") return cliTransfer<int>(import, argv[3], argv[4], fmt);
+            if (type == "string") return cliTransfer<std::string>(import, argv[3], argv[4], fmt);
+            if (type == "person") return cliTransfer<Person>(import, argv[3], argv[4], fmt);
+        }
+    }
+    LoadGenConfig cfg;
+    if (cmd == "loadgen" && argc >= 4 && parseLoadGenArgs(argc, argv, 4, cfg)) {
+        if (type == "int") return cliLoadGen<int>(argv[3], cfg);
+        if (type == "string") return cliLoadGen<std::string>(argv[3], cfg);
+        if (type == "person") return cliLoadGen<Person>(argv[3], cfg);
+    }
+    if (cmd == "async" && argc >= 4) {
+        int n = argc >= 5 ? std::atoi(argv[4]) : 1000;
+        if (n >= 0) {
+            if (type == "int") return cliAsync<int>(argv[3], n);
+            if (type == "string") return cliAsync<std::string>(argv[3], n);
+            if (type == "person") return cliAsync<Person>(argv[3], n);
+        }
+    }
+    std::cout << "Использование:\n"
+              << "  " << argv[0] << " analyze <int|string|person> <файл> [--compact]\n"
+              << "  " << argv[0] << " verify <int|string|person> <файл> [--rebuild|--crc-on|--crc-off]\n"
+              << "  " << argv[0] << " backup <int|string|person> <файл> <копия>\n"
+              << "  " << argv[0] << " lists <контейнер>\n"
+              << "  " << argv[0] << " import <int|string|person> <файл> <источник> [--text|--csv|--raw]\n"
+              << "  " << argv[0] << " export <int|string|person> <файл> <приёмник> [--text|--csv|--raw]\n"
+              << "  " << argv[0] << " loadgen <int|string|person> <файл> [--producers N] [--consumers N]\n"
+              << "      [--processes] [--rate R] [--seconds S] [--len MIN:MAX]\n"
+              << "  " << argv[0] << " async <int|string|person> <файл> [N]   (сборка C++20)\n";
+    return 2;
+}
+
 //-----------------------------------------------------
 // Меню для int
 //-----------------------------------------------------
@@ -1000,6 +6558,12 @@ void menuInt() {
             << "10. size\n"
             << "11. sort\n"
             << "12. итератор (пошаговый вывод)\n"
+            << "13. splice (перенести другой файл в конец)\n"
+            << "14. merge (слить с отсортированным файлом)\n"
+            << "15. сумма элементов (параллельно)\n"
+            << "16. insert_sorted (вставка с сохранением порядка)\n"
+            << "17. find (бинарный поиск)\n"
+            << "18. pop_front_n (снять N элементов с головы)\n"
             << "0. Назад\n"
             << "Ваш выбор: ";
         int c;
@@ -1078,13 +6642,70 @@ void menuInt() {
         case 12: {
             list.initIterator();
             while (list.hasNext()) {
-                int x = list.next();
-                std::cout << x << " ";
+                std::cout << list.nextView() << " ";
             }
             std::cout << "\n";
             system("pause");
             break;
         }
+        case 13: {
+            std::cout << "Введите имя файла, который перенести в конец: ";
+            std::string other;
+            std::cin >> other;
+            BinaryList<int> src(other);
+            list.splice(src);
+            std::cout << "size = " << list.getSize() << "\n";
+            system("pause");
+            break;
+        }
+        case 14: {
+            std::cout << "Введите имя отсортированного файла для слияния: ";
+            std::string other;
+            std::cin >> other;
+            BinaryList<int> src(other);
+            list.merge(src);
+            std::cout << "size = " << list.getSize() << "\n";
+            system("pause");
+            break;
+        }
+        case 15: {
+            long long sum = list.transform_reduce(0LL,
+                [](long long a, long long b) { return a + b; },
+                [](int v) { return (long long)v; });
+            std::cout << "Сумма = " << sum << "\n";
+            system("pause");
+            break;
+        }
+        case 16: {
+            std::cout << "Введите число: ";
+            int val;
+            std::cin >> val;
+            list.insert_sorted(val);
+            system("pause");
+            break;
+        }
+        case 17: {
+            std::cout << "Введите число: ";
+            int val;
+            std::cin >> val;
+            int idx = list.find(val);
+            if (idx >= 0) std::cout << "Найден, index = " << idx << "\n";
+            else std::cout << "Не найден\n";
+            system("pause");
+            break;
+        }
+        case 18: {
+            std::cout << "Сколько снять: ";
+            int cnt;
+            std::cin >> cnt;
+            std::vector<int> buf(cnt > 0 ? cnt : 0);
+            int got = list.pop_front_n(cnt, buf.data());
+            std::cout << "Снято " << got << ":";
+            for (int i = 0; i < got; i++) std::cout << " " << buf[i];
+            std::cout << "\n";
+            system("pause");
+            break;
+        }
         default:
             std::cout << "Неверный пункт.\n";
             system("pause");
@@ -1118,6 +6739,16 @@ void menuString() {
             << "10. size\n"
             << "11. sort\n"
             << "12. итератор (пошаговый вывод)\n"
+            << "13. splice (перенести другой файл в конец)\n"
+            << "14. merge (слить с отсортированным файлом)\n"
+            << "15. count_if: строки длиннее N (параллельно)\n"
+            << "16. insert_sorted (вставка с сохранением порядка)\n"
+            << "17. find (бинарный поиск)\n"
+            << "18. contains по хеш-индексу (индекс создаётся при первом вызове)\n"
+            << "19. contains через фильтр Блума (фильтр создаётся при первом вызове)\n"
+            << "20. unique (убрать соседние повторы; после sort — все)\n"
+            << "21. remove (удалить все вхождения строки)\n"
+            << "22. слоты по классам размера (вкл/выкл)\n"
             << "0. Назад\n"
             << "Ваш выбор: ";
         int c;
@@ -1197,13 +6828,97 @@ void menuString() {
         case 12: {
             list.initIterator();
             while (list.hasNext()) {
-                std::string s = list.next();
-                std::cout << s << " ";
+                std::cout << list.nextView() << " ";
             }
             std::cout << "\n";
             system("pause");
             break;
         }
+        case 13: {
+            std::cout << "Введите имя файла, который перенести в конец: ";
+            std::string other;
+            std::cin >> other;
+            BinaryList<std::string> src(other);
+            list.splice(src);
+            std::cout << "size = " << list.getSize() << "\n";
+            system("pause");
+            break;
+        }
+        case 14: {
+            std::cout << "Введите имя отсортированного файла для слияния: ";
+            std::string other;
+            std::cin >> other;
+            BinaryList<std::string> src(other);
+            list.merge(src);
+            std::cout << "size = " << list.getSize() << "\n";
+            system("pause");
+            break;
+        }
+        case 15: {
+            std::cout << "Введите N: ";
+            size_t n;
+            std::cin >> n;
+            int cnt = list.count_if([n](const std::string& v) { return v.size() > n; });
+            std::cout << "Строк длиннее " << n << ": " << cnt << "\n";
+            system("pause");
+            break;
+        }
+        case 16: {
+            std::cout << "Введите строку (без пробелов): ";
+            std::string val;
+            std::cin >> val;
+            list.insert_sorted(val);
+            system("pause");
+            break;
+        }
+        case 17: {
+            std::cout << "Введите строку (без пробелов): ";
+            std::string val;
+            std::cin >> val;
+            int idx = list.find(val);
+            if (idx >= 0) std::cout << "Найден, index = " << idx << "\n";
+            else std::cout << "Не найден\n";
+            system("pause");
+            break;
+        }
+        case 18: {
+            std::cout << "Введите строку: ";
+            std::string key;
+            std::cin >> key;
+            list.enableHashIndex();
+            std::cout << (list.contains(key) ? "Есть в списке\n" : "Нет в списке\n");
+            system("pause");
+            break;
+        }
+        case 19: {
+            std::cout << "Введите строку: ";
+            std::string key;
+            std::cin >> key;
+            list.enableBloomFilter();
+            std::cout << (list.contains(key) ? "Есть в списке\n" : "Нет в списке\n");
+            system("pause");
+            break;
+        }
+        case 20: {
+            std::cout << "Удалено повторов: " << list.unique() << "\n";
+            system("pause");
+            break;
+        }
+        case 21: {
+            std::cout << "Введите строку: ";
+            std::string key;
+            std::cin >> key;
+            std::cout << "Удалено: " << list.remove(key) << "\n";
+            system("pause");
+            break;
+        }
+        case 22: {
+            if (list.hasSlabs()) list.disableSlabs();
+            else list.enableSlabs();
+            std::cout << "Слоты по классам размера: " << (list.hasSlabs() ? "вкл" : "выкл") << "\n";
+            system("pause");
+            break;
+        }
         default:
             std::cout << "Неверный пункт.\n";
             system("pause");
@@ -1237,6 +6952,17 @@ void menuPerson() {
             << "10. size\n"
             << "11. sort\n"
             << "12. итератор (пошаговый вывод)\n"
+            << "13. splice (перенести другой файл в конец)\n"
+            << "14. merge (слить с отсортированным файлом)\n"
+            << "15. count_if: возраст больше N (параллельно)\n"
+            << "16. insert_sorted (вставка с сохранением порядка)\n"
+            << "17. find (бинарный поиск)\n"
+            << "18. contains по хеш-индексу (индекс создаётся при первом вызове)\n"
+            << "19. contains через фильтр Блума (фильтр создаётся при первом вызове)\n"
+            << "20. выравнивание узлов (0, 8, 64, 4096)\n"
+            << "21. sort_by(age) (перестановка ссылок)\n"
+            << "22. поиск по диапазону возраста (find_all)\n"
+            << "23. удалить по диапазону возраста (remove_if)\n"
             << "0. Назад\n"
             << "Ваш выбор: ";
         int c;
@@ -1339,9 +7065,227 @@ void menuPerson() {
         case 12: {
             list.initIterator();
             while (list.hasNext()) {
-                Person p = list.next();
-                std::cout << p << "\n";
+                std::cout << list.nextView() << "\n";
+            }
+            system("pause");
+            break;
+        }
+        case 13: {
+            std::cout << "Введите имя файла, который перенести в конец: ";
+            std::string other;
+            std::cin >> other;
+            BinaryList<Person> src(other);
+            list.splice(src);
+            std::cout << "size = " << list.getSize() << "\n";
+            system("pause");
+            break;
+        }
+        case 14: {
+            std::cout << "Введите имя отсортированного файла для слияния: ";
+            std::string other;
+            std::cin >> other;
+            BinaryList<Person> src(other);
+            list.merge(src);
+            std::cout << "size = " << list.getSize() << "\n";
+            system("pause");
+            break;
+        }
+        case 15: {
+            std::cout << "Введите N: ";
+            int n;
+            std::cin >> n;
+            int cnt = list.count_if([n](const Person& p) { return p.age > n; });
+            std::cout << "Старше " << n << ": " << cnt << "\n";
+            system("pause");
+            break;
+        }
+        case 16: {
+            std::cout << "Введите имя (без пробелов) и возраст:\n";
+            char nm[40];
+            int ag;
+            std::cin >> nm >> ag;
+            Person val(nm, ag);
+            list.insert_sorted(val);
+            system("pause");
+            break;
+        }
+        case 17: {
+            std::cout << "Введите имя (без пробелов) и возраст:\n";
+            char nm[40];
+            int ag;
+            std::cin >> nm >> ag;
+            Person val(nm, ag);
+            int idx = list.find(val);
+            if (idx >= 0) std::cout << "Найден, index = " << idx << "\n";
+            else std::cout << "Не найден\n";
+            system("pause");
+            break;
+        }
+        case 18: {
+            std::cout << "Введите имя: ";
+            std::string key;
+            std::cin >> key;
+            list.enableHashIndex();
+            Person p;
+            if (list.find(key, p)) std::cout << "Найден: " << p << "\n";
+            else std::cout << "Нет в списке\n";
+            system("pause");
+            break;
+        }
+        case 19: {
+            std::cout << "Введите имя: ";
+            std::string key;
+            std::cin >> key;
+            list.enableBloomFilter();
+            std::cout << (list.contains(key) ? "Есть в списке\n" : "Нет в списке\n");
+            system("pause");
+            break;
+        }
+        case 20: {
+            std::cout << "Текущее выравнивание: " << list.getAlignment() << "\nНовое: ";
+            int a;
+            std::cin >> a;
+            if (list.setAlignment(a)) std::cout << "Узлы переписаны.\n";
+            system("pause");
+            break;
+        }
+        case 21: {
+            // Читается только поле age, данные узлов не переписываются
+            list.sort_by(&Person::age);
+            std::cout << "Отсортировано по возрасту.\n";
+            system("pause");
+            break;
+        }
+        case 22: {
+            std::cout << "Возраст от и до: ";
+            int lo, hi;
+            std::cin >> lo >> hi;
+            std::vector<int> idx = list.find_all(&Person::age, [=](int a) { return a >= lo && a <= hi; });
+            for (int i : idx) {
+                std::cout << "  [" << i << "]: " << list.get(i) << "\n";
             }
+            std::cout << "Найдено: " << idx.size() << "\n";
+            system("pause");
+            break;
+        }
+        case 23: {
+            std::cout << "Возраст от и до: ";
+            int lo, hi;
+            std::cin >> lo >> hi;
+            int n = list.remove_if([=](const Person& p) { return p.age >= lo && p.age <= hi; });
+            std::cout << "Удалено: " << n << "\n";
+            system("pause");
+            break;
+        }
+        default:
+            std::cout << "Неверный пункт.\n";
+            system("pause");
+        }
+    }
+}
+
+//-----------------------------------------------------
+// Меню для сегментированной очереди int
+//-----------------------------------------------------
+void menuSegmented() {
+    std::cout << "Введите имя файла-манифеста (например, intQueue.bin): ";
+    std::string fname;
+    std::cin >> fname;
+    std::cout << "Элементов в сегменте (для нового списка): ";
+    int cap;
+    std::cin >> cap;
+
+    SegmentedList<int> list(fname, cap);
+
+    while (true) {
+        system("cls");
+        std::cout << "=== Меню (сегментированная очередь int) ===\n"
+            << "1. push_back\n"
+            << "2. insert(index)\n"
+            << "3. erase(index)\n"
+            << "4. get(index)\n"
+            << "5. update(index)\n"
+            << "6. pop_back\n"
+            << "7. pop_front\n"
+            << "8. clear\n"
+            << "9. print\n"
+            << "10. size / число сегментов\n"
+            << "11. pop_front_n (снять N элементов с головы)\n"
+            << "0. Назад\n"
+            << "Ваш выбор: ";
+        int c;
+        std::cin >> c;
+        if (!std::cin.good()) {
+            std::cin.clear();
+            std::cin.ignore(9999, '\n');
+            continue;
+        }
+        if (c == 0) {
+            break;
+        }
+        switch (c) {
+        case 1: {
+            std::cout << "Введите число: ";
+            int val;
+            std::cin >> val;
+            list.push_back(val);
+            break;
+        }
+        case 2: {
+            std::cout << "Введите index и число: ";
+            int idx, val;
+            std::cin >> idx >> val;
+            list.insert(idx, val);
+            break;
+        }
+        case 3: {
+            std::cout << "Введите index: ";
+            int idx;
+            std::cin >> idx;
+            list.erase(idx);
+            break;
+        }
+        case 4: {
+            std::cout << "Введите index: ";
+            int idx;
+            std::cin >> idx;
+            std::cout << "Получили: " << list.get(idx) << "\n";
+            system("pause");
+            break;
+        }
+        case 5: {
+            std::cout << "Введите index и новое значение: ";
+            int idx, val;
+            std::cin >> idx >> val;
+            list.update(idx, val);
+            break;
+        }
+        case 6:
+            list.pop_back();
+            break;
+        case 7:
+            list.pop_front();
+            break;
+        case 8:
+            list.clear();
+            std::cout << "Список очищен.\n";
+            system("pause");
+            break;
+        case 9:
+            system("cls");
+            list.print();
+            system("pause");
+            break;
+        case 10:
+            std::cout << "size = " << list.getSize()
+                      << ", сегментов = " << list.getSegmentCount() << "\n";
+            system("pause");
+            break;
+        case 11: {
+            std::cout << "Сколько снять: ";
+            int cnt;
+            std::cin >> cnt;
+            std::cout << "Снято: " << list.pop_front_n(cnt) << "\n";
             system("pause");
             break;
         }